@@ -0,0 +1,183 @@
+/*
+ * Loopback benchmark of zpacker_async.hpp: request / reply round trips over many Unix domain socket pairs
+ *
+ *   zpacker_async_bench [--connections N] [--messages N] [--payload N] [--incremental]
+ *
+ * A server loop and a client loop run on their own threads. Every client connection sends a message, waits for the
+ * server to echo it and records the round trip, the server decodes every message before encoding the reply.
+ * `--payload` sets the number of uint32 in a message, `--incremental` has the server decode messages while they come
+ * in with a `frame_decoder` instead of once they are complete with a `frame_receiver`.
+ */
+
+#include "zpacker_async.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/* sent timestamp, sender and payload */
+using Message = std::tuple<uint64_t, std::string, std::vector<uint32_t>>;
+
+static uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+static void set_non_blocking(int fd)
+{
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+zeus::detached serve(zeus::event_loop &loop, int fd)
+{
+    zeus::frame_receiver receiver{};
+    zeus::frame_sender sender{};
+
+    while (co_await zeus::async_receive(loop, fd, receiver) == zeus::io_status::done)
+    {
+        auto message = receiver.decode<Message>();
+
+        if (!message)
+            break;
+
+        sender.assign(zeus::serialize(*message));
+
+        if (co_await zeus::async_send(loop, fd, sender) != zeus::io_status::done)
+            break;
+    }
+
+    ::close(fd);
+}
+
+zeus::detached serve_incremental(zeus::event_loop &loop, int fd)
+{
+    zeus::frame_decoder<Message> decoder{};
+    zeus::frame_sender sender{};
+
+    while (co_await zeus::async_receive(loop, fd, decoder) == zeus::io_status::done)
+    {
+        auto &message = decoder.result();
+
+        if (!message)
+            break;
+
+        sender.assign(zeus::serialize(*message));
+
+        if (co_await zeus::async_send(loop, fd, sender) != zeus::io_status::done)
+            break;
+    }
+
+    ::close(fd);
+}
+
+zeus::detached call(zeus::event_loop &loop, int fd, std::size_t count, std::size_t payload, std::vector<uint64_t> &latencies)
+{
+    zeus::frame_receiver receiver{};
+    zeus::frame_sender sender{};
+
+    Message message{0, "client #" + std::to_string(fd), std::vector<uint32_t>(payload, static_cast<uint32_t>(fd))};
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::get<0>(message) = now_ns();
+
+        sender.assign(zeus::serialize(message));
+
+        if (co_await zeus::async_send(loop, fd, sender) != zeus::io_status::done)
+            break;
+
+        if (co_await zeus::async_receive(loop, fd, receiver) != zeus::io_status::done)
+            break;
+
+        auto reply = receiver.decode<Message>();
+
+        if (!reply)
+            break;
+
+        latencies.push_back(now_ns() - std::get<0>(*reply));
+    }
+
+    ::close(fd);
+}
+
+int main(int argc, char const *argv[])
+{
+    std::size_t connections = 256;
+    std::size_t messages = 2000;
+    std::size_t payload = 16;
+    bool incremental = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--incremental") == 0)
+            incremental = true;
+        else if (i + 1 >= argc)
+            break;
+        else if (strcmp(argv[i], "--connections") == 0)
+            connections = std::strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--messages") == 0)
+            messages = std::strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--payload") == 0)
+            payload = std::strtoul(argv[++i], nullptr, 10);
+    }
+
+    zeus::event_loop server_loop{};
+    zeus::event_loop client_loop{};
+
+    std::vector<uint64_t> latencies{};
+
+    latencies.reserve(connections * messages);
+
+    for (std::size_t i = 0; i < connections; ++i)
+    {
+        int fds[2];
+
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            perror("socketpair");
+            return 1;
+        }
+
+        set_non_blocking(fds[0]);
+        set_non_blocking(fds[1]);
+
+        if (incremental)
+            serve_incremental(server_loop, fds[0]);
+        else
+            serve(server_loop, fds[0]);
+
+        call(client_loop, fds[1], messages, payload, latencies);
+    }
+
+    auto begin = now_ns();
+
+    std::thread server{[&server_loop]()
+                       { server_loop.run(); }};
+
+    client_loop.run();
+
+    auto elapsed = now_ns() - begin;
+
+    server.join();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](double p)
+    {
+        return latencies.empty() ? 0.0 : latencies[static_cast<std::size_t>(p * (latencies.size() - 1))] / 1000.0;
+    };
+
+    printf("connections %zu, round trips %zu, %s decoding\n", connections, latencies.size(), incremental ? "incremental" : "whole frame");
+    printf("%.0f round trips/s\n", latencies.size() * 1e9 / elapsed);
+    printf("latency us: p50 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n", percentile(0.5), percentile(0.99), percentile(0.999), percentile(1.0));
+
+    return latencies.size() == connections * messages ? 0 : 1;
+}
@@ -0,0 +1,1233 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "zpacker.hpp"
+#include "zpacker_flat.hpp"
+
+/*
+ * Self-contained benchmark suite for zpacker
+ *
+ * usage: zpacker_bench [--json] [--filter <substring>] [--min-time <seconds>]
+ *
+ * every case reports ns/op, MB/s of serialized bytes, heap allocations and copies / moves of `Counted` values per op
+ * `--json` prints the results as a JSON array so that runs of different commits can be compared
+ *
+ * the `zpacker_bench_stats` target is the same suite built with `ZPACKER_ENABLE_STATS`, comparing it with
+ * `zpacker_bench` shows the cost of the instrumentation, `zpacker_bench` itself must match an uninstrumented build
+ */
+
+/* global allocation counter, every form of operator new of the process goes through here */
+static std::atomic<std::uint64_t> g_allocations{0};
+
+static void *counted_alloc(std::size_t size, std::size_t alignment = 0) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    size = size ? size : 1;
+
+    if (alignment == 0)
+        return std::malloc(size);
+
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    /* aligned_alloc wants a multiple of the alignment */
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void counted_free(void *p, std::size_t alignment = 0) noexcept
+{
+#if defined(_MSC_VER)
+    if (alignment != 0)
+        return _aligned_free(p);
+#else
+    (void)alignment;
+#endif
+
+    std::free(p);
+}
+
+static void *counted_alloc_or_throw(std::size_t size, std::size_t alignment = 0)
+{
+    if (auto p = counted_alloc(size, alignment))
+        return p;
+
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size) { return counted_alloc_or_throw(size); }
+void *operator new[](std::size_t size) { return counted_alloc_or_throw(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+
+void *operator new(std::size_t size, std::align_val_t al) { return counted_alloc_or_throw(size, static_cast<std::size_t>(al)); }
+void *operator new[](std::size_t size, std::align_val_t al) { return counted_alloc_or_throw(size, static_cast<std::size_t>(al)); }
+void *operator new(std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept { return counted_alloc(size, static_cast<std::size_t>(al)); }
+void *operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept { return counted_alloc(size, static_cast<std::size_t>(al)); }
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+
+void operator delete(void *p, std::align_val_t al) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+void operator delete[](void *p, std::align_val_t al) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+void operator delete(void *p, std::size_t, std::align_val_t al) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+void operator delete[](void *p, std::size_t, std::align_val_t al) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+void operator delete(void *p, std::align_val_t al, const std::nothrow_t &) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+void operator delete[](void *p, std::align_val_t al, const std::nothrow_t &) noexcept { counted_free(p, static_cast<std::size_t>(al)); }
+
+/* copies and moves of `Counted` values, shows how often decoded values are relocated */
+static std::atomic<std::uint64_t> g_relocations{0};
+
+/* keep the optimizer from dropping the results */
+static volatile std::size_t g_sink;
+
+template <class _Ty>
+void do_not_optimize(const _Ty &value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(std::addressof(value)) : "memory");
+#else
+    if constexpr (std::is_arithmetic_v<_Ty>)
+        g_sink = g_sink + static_cast<std::size_t>(value);
+    else
+        g_sink = g_sink + reinterpret_cast<std::uintptr_t>(std::addressof(value));
+#endif
+}
+
+struct bench_result
+{
+    std::string name;
+    std::size_t bytes_per_op;
+    std::uint64_t iterations;
+    double ns_per_op;
+    double mb_per_s;
+    double allocs_per_op;
+    double relocations_per_op;
+};
+
+class bench_runner
+{
+public:
+    bench_runner(double min_time, std::string filter) : m_min_time(min_time), m_filter(std::move(filter)) {}
+
+    /*
+     * Run `fn` repeatedly, `bytes` is the amount of serialized data one call processes
+     */
+    void run(const std::string &name, std::size_t bytes, const std::function<void()> &fn)
+    {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+            return;
+
+        // calibrate the iteration count so that one round takes at least `m_min_time` / 4
+        std::uint64_t iterations = 1;
+
+        while (elapsed_seconds(fn, iterations) < m_min_time / 4 && iterations < (1ull << 40))
+            iterations *= 2;
+
+        double best = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t relocations = 0;
+
+        for (int round = 0; round < 3; ++round)
+        {
+            auto before = g_allocations.load(std::memory_order_relaxed);
+            auto relocations_before = g_relocations.load(std::memory_order_relaxed);
+
+            auto seconds = elapsed_seconds(fn, iterations);
+
+            allocations = g_allocations.load(std::memory_order_relaxed) - before;
+            relocations = g_relocations.load(std::memory_order_relaxed) - relocations_before;
+
+            if (round == 0 || seconds < best)
+                best = seconds;
+        }
+
+        bench_result result{};
+
+        result.name = name;
+        result.bytes_per_op = bytes;
+        result.iterations = iterations;
+        result.ns_per_op = best * 1e9 / iterations;
+        result.mb_per_s = bytes * iterations / best / (1024.0 * 1024.0);
+        result.allocs_per_op = static_cast<double>(allocations) / iterations;
+        result.relocations_per_op = static_cast<double>(relocations) / iterations;
+
+        m_results.push_back(result);
+    }
+
+    void print_table() const
+    {
+        printf("instrumentation: %s\n", zeus::stats::enabled ? "enabled" : "disabled");
+
+        printf("%-40s %12s %12s %12s %12s %12s\n", "benchmark", "bytes/op", "ns/op", "MB/s", "allocs/op", "moves/op");
+
+        for (auto &r : m_results)
+            printf("%-40s %12zu %12.2f %12.2f %12.2f %12.2f\n", r.name.c_str(), r.bytes_per_op, r.ns_per_op, r.mb_per_s, r.allocs_per_op, r.relocations_per_op);
+    }
+
+    void print_json() const
+    {
+        printf("[\n");
+
+        for (std::size_t i = 0; i < m_results.size(); ++i)
+        {
+            auto &r = m_results[i];
+
+            printf("  {\"name\": \"%s\", \"stats\": %s, \"bytes_per_op\": %zu, \"iterations\": %llu, \"ns_per_op\": %.3f, \"mb_per_s\": %.3f, \"allocs_per_op\": %.3f, \"moves_per_op\": %.3f}%s\n",
+                   r.name.c_str(), zeus::stats::enabled ? "true" : "false", r.bytes_per_op, static_cast<unsigned long long>(r.iterations),
+                   r.ns_per_op, r.mb_per_s, r.allocs_per_op, r.relocations_per_op, i + 1 == m_results.size() ? "" : ",");
+        }
+
+        printf("]\n");
+    }
+
+private:
+    static double elapsed_seconds(const std::function<void()> &fn, std::uint64_t iterations)
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        for (std::uint64_t i = 0; i < iterations; ++i)
+            fn();
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    double m_min_time;
+    std::string m_filter;
+    std::vector<bench_result> m_results;
+};
+
+/* mirrors the types of example.cpp */
+struct Row
+{
+    uint16_t value;
+    std::vector<int> data;
+
+    std::size_t get_size() const
+    {
+        return zeus::get_size(value) + zeus::get_size(data);
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, Row>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        writer << value << data;
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, Row>, int> = 0>
+    static Row deserialize(_Reader &reader)
+    {
+        Row self{};
+
+        reader >> self.value >> self.data;
+
+        return self;
+    }
+};
+
+struct Complicated
+{
+    std::wstring name;
+    std::unordered_map<uint32_t, Row> map;
+
+    std::size_t get_size() const
+    {
+        return zeus::get_size(name) + zeus::get_size(map);
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, Complicated>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        writer << name << map;
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, Complicated>, int> = 0>
+    static Complicated deserialize(_Reader &reader)
+    {
+        Complicated self{};
+
+        reader >> self.name >> self.map;
+
+        return self;
+    }
+};
+
+/* the same fields encoded positionally and as a tagged record, to measure the cost of the tags */
+struct Profile
+{
+    uint32_t id;
+    std::string name;
+    uint64_t created;
+    std::vector<uint32_t> groups;
+    double score;
+
+    bool operator==(const Profile &other) const
+    {
+        return id == other.id && name == other.name && created == other.created && groups == other.groups && score == other.score;
+    }
+
+    std::size_t get_size() const
+    {
+        return zeus::get_size(id) + zeus::get_size(name) + zeus::get_size(created) + zeus::get_size(groups) + zeus::get_size(score);
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, Profile>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        writer << id << name << created << groups << score;
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, Profile>, int> = 0>
+    static Profile deserialize(_Reader &reader)
+    {
+        Profile self{};
+
+        reader >> self.id >> self.name >> self.created >> self.groups >> self.score;
+
+        return self;
+    }
+};
+
+struct ProfileRecord : Profile
+{
+    std::size_t get_size() const
+    {
+        return zeus::get_record_size(zeus::field(1, id), zeus::field(2, name), zeus::field(3, created), zeus::field(4, groups), zeus::field(5, score));
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, ProfileRecord>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        zeus::write_record(writer, zeus::field(1, id), zeus::field(2, name), zeus::field(3, created), zeus::field(4, groups), zeus::field(5, score));
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, ProfileRecord>, int> = 0>
+    static ProfileRecord deserialize(_Reader &reader)
+    {
+        ProfileRecord self{};
+
+        zeus::read_record(reader, zeus::field(1, self.id), zeus::field(2, self.name), zeus::field(3, self.created), zeus::field(4, self.groups), zeus::field(5, self.score));
+
+        return self;
+    }
+};
+
+/* the fields of `Profile` without serialization methods, enumerated by zpacker */
+struct ProfileFields
+{
+    uint32_t id;
+    std::string name;
+    uint64_t created;
+    std::vector<uint32_t> groups;
+    double score;
+};
+
+/* trivially copyable, 7 bytes of padding out of 24 */
+struct Tick
+{
+    uint8_t side;
+    uint64_t price;
+    uint32_t quantity;
+};
+
+/* the same fields written without the padding */
+struct PackedTick
+{
+    uint8_t side;
+    uint64_t price;
+    uint32_t quantity;
+};
+
+template <>
+inline constexpr bool zeus::pack_fields_v<PackedTick> = true;
+
+/* a string that counts its copies and moves into `g_relocations` */
+struct Counted
+{
+    std::string value;
+
+    Counted() = default;
+
+    Counted(std::string v) : value(std::move(v)) {}
+
+    Counted(const Counted &other) : value(other.value)
+    {
+        g_relocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Counted(Counted &&other) noexcept : value(std::move(other.value))
+    {
+        g_relocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Counted &operator=(const Counted &other)
+    {
+        value = other.value;
+        g_relocations.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    Counted &operator=(Counted &&other) noexcept
+    {
+        value = std::move(other.value);
+        g_relocations.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    bool operator<(const Counted &other) const
+    {
+        return value < other.value;
+    }
+
+    std::size_t get_size() const
+    {
+        return zeus::get_size(value);
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, Counted>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        writer << value;
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, Counted>, int> = 0>
+    static Counted deserialize(_Reader &reader)
+    {
+        Counted self{};
+
+        reader >> self.value;
+
+        return self;
+    }
+};
+
+/* a small fixed-size message, 20 fields */
+using SmallMessage = std::tuple<
+    uint32_t, uint32_t, uint64_t, uint64_t, int32_t,
+    int32_t, uint16_t, uint16_t, uint8_t, uint8_t,
+    double, double, float, float, uint32_t,
+    uint32_t, int64_t, int64_t, uint16_t, uint8_t>;
+
+/* the same fields written one by one, every field is bounds checked by the writer */
+struct SmallMessageFields
+{
+    SmallMessage fields;
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, SmallMessageFields>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        std::apply([&writer](const auto &...v)
+                   { (writer << ... << v); },
+                   fields);
+    }
+};
+
+/*
+ * Register the encode, decode, skip and get_size cases of one object
+ */
+template <class _Ty>
+void bench_codec(bench_runner &runner, const std::string &name, const _Ty &object)
+{
+    std::vector<std::uint8_t> encoded{};
+    zeus::bytes_writer encoder{encoded};
+
+    zeus::serialize_object(encoder, object);
+
+    const auto bytes = encoded.size();
+
+    std::vector<std::uint8_t> buffer{};
+
+    buffer.reserve(bytes);
+
+    runner.run(name + "/encode", bytes, [&]()
+               {
+        buffer.clear();
+
+        zeus::bytes_writer writer{buffer};
+
+        zeus::serialize_object(writer, object);
+
+        do_not_optimize(buffer.data()); });
+
+    runner.run(name + "/decode", bytes, [&]()
+               {
+        zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+        auto decoded = zeus::deserialize_object<_Ty>(reader);
+
+        do_not_optimize(decoded); });
+
+    runner.run(name + "/skip", bytes, [&]()
+               {
+        zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+        zeus::skip_object<_Ty>(reader);
+
+        do_not_optimize(reader.count()); });
+
+    runner.run(name + "/get_size", bytes, [&]()
+               {
+        auto size = zeus::get_size(object);
+
+        do_not_optimize(size); });
+
+    runner.run(name + "/serialize_packed", bytes, [&]()
+               {
+        auto packed = zeus::serialize(object, zeus::crc32_checksum{});
+
+        do_not_optimize(packed); });
+}
+
+void bench_checksums(bench_runner &runner)
+{
+    std::vector<std::uint8_t> data(64 * 1024);
+
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 131 + 7);
+
+    runner.run("checksum/crc8/64k", data.size(), [&]()
+               { do_not_optimize(zeus::crc8_checksum{}(data.data(), data.size())); });
+
+    runner.run("checksum/crc16/64k", data.size(), [&]()
+               { do_not_optimize(zeus::crc16_checksum{}(data.data(), data.size())); });
+
+    runner.run("checksum/crc32/64k", data.size(), [&]()
+               { do_not_optimize(zeus::crc32_checksum{}(data.data(), data.size())); });
+}
+
+/*
+ * Verify a 4 KB region of a chunked blob against verifying the whole payload
+ */
+void bench_chunked(bench_runner &runner)
+{
+    std::vector<std::string> lines{};
+
+    for (uint32_t i = 0; i < 256 * 1024; ++i)
+        lines.push_back("log line #" + std::to_string(i));
+
+    auto blob = zeus::serialize_chunked(lines);
+
+    zeus::chunk_table table{};
+
+    table.parse(blob.data(), blob.size());
+
+    const auto payload_size = table.payload_size();
+
+    runner.run("chunked/4m/serialize", payload_size, [&]()
+               {
+        auto packed = zeus::serialize_chunked(lines);
+
+        do_not_optimize(packed); });
+
+    runner.run("chunked/4m/verify_payload", payload_size, [&]()
+               { do_not_optimize(zeus::crc32_checksum{}(table.payload(), payload_size)); });
+
+    runner.run("chunked/4m/verify_4k", 4096, [&]()
+               {
+        zeus::chunk_table fresh{};
+
+        fresh.parse(blob.data(), blob.size());
+
+        do_not_optimize(fresh.verify(payload_size / 2, 4096)); });
+}
+
+/*
+ * Sum the samples of a padded array in place against decoding them into a vector first
+ */
+void bench_aligned(bench_runner &runner)
+{
+    std::vector<double> samples(256 * 1024);
+
+    for (std::size_t i = 0; i < samples.size(); ++i)
+        samples[i] = i * 0.5;
+
+    auto packed = zeus::serialize_aligned(samples);
+
+    /* a mmapped file or shared memory would be page aligned */
+    auto buffer = static_cast<std::uint8_t *>(std::aligned_alloc(64, (packed.size() + 63) / 64 * 64));
+
+    memcpy(buffer, packed.data(), packed.size());
+
+    const auto payload = buffer + sizeof(zeus::packer_header);
+    const auto payload_size = packed.size() - sizeof(zeus::packer_header);
+
+    runner.run("aligned/vector<double>/256k/serialize_aligned", payload_size, [&]()
+               {
+        auto data = zeus::serialize_aligned(samples);
+
+        do_not_optimize(data); });
+
+    runner.run("aligned/vector<double>/256k/sum/deserialize", payload_size, [&]()
+               {
+        zeus::bytes_reader_bounded reader{payload, payload_size};
+
+        auto decoded = zeus::deserialize_object<std::vector<double>>(reader);
+
+        do_not_optimize(std::accumulate(decoded.begin(), decoded.end(), 0.0)); });
+
+    runner.run("aligned/vector<double>/256k/sum/read_array_view", payload_size, [&]()
+               {
+        zeus::bytes_reader_bounded reader{payload, payload_size};
+
+        auto view = zeus::read_array_view<double>(reader);
+
+        do_not_optimize(std::accumulate(view.begin(), view.end(), 0.0)); });
+
+    std::free(buffer);
+}
+
+/*
+ * Encode and decode a vector as it is and with `set_sparse`, the bytes of each case are its own encoded size
+ */
+template <class _Ty>
+void bench_sparse_case(bench_runner &runner, const std::string &name, const std::vector<_Ty> &values)
+{
+    for (bool sparse : {false, true})
+    {
+        const auto prefix = "sparse/" + name + (sparse ? "/sparse" : "/dense");
+
+        std::vector<std::uint8_t> encoded{};
+        zeus::bytes_writer encoder{encoded};
+
+        encoder.set_sparse(sparse);
+
+        zeus::serialize_object(encoder, values);
+
+        const auto bytes = encoded.size();
+
+        std::vector<std::uint8_t> buffer{};
+
+        buffer.reserve(bytes);
+
+        runner.run(prefix + "/encode", bytes, [&]()
+                   {
+            buffer.clear();
+
+            zeus::bytes_writer writer{buffer};
+
+            writer.set_sparse(sparse);
+
+            zeus::serialize_object(writer, values);
+
+            do_not_optimize(buffer.data()); });
+
+        runner.run(prefix + "/decode", bytes, [&]()
+                   {
+            zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+            auto decoded = zeus::deserialize_object<std::vector<_Ty>>(reader);
+
+            do_not_optimize(decoded); });
+    }
+}
+
+/*
+ * Mostly zero histograms, feature vectors with long runs and random values which stay dense
+ */
+void bench_sparse(bench_runner &runner)
+{
+    std::vector<uint32_t> histogram(1024 * 1024);
+    std::vector<float> features(1024 * 1024);
+    std::vector<uint32_t> random(1024 * 1024);
+
+    for (std::size_t i = 0; i < histogram.size(); ++i)
+    {
+        auto hash = static_cast<uint32_t>(i * 2654435761u);
+
+        /* 1% non-zero */
+        if (hash % 100 == 0)
+            histogram[i] = hash >> 20;
+
+        features[i] = static_cast<float>(i / 64 % 7) * 0.5f;
+        random[i] = hash;
+    }
+
+    bench_sparse_case(runner, "vector<uint32_t>/1M/1%", histogram);
+    bench_sparse_case(runner, "vector<float>/1M/runs", features);
+    bench_sparse_case(runner, "vector<uint32_t>/1M/random", random);
+}
+
+/*
+ * Encode and decode a series as it is and with `set_xor_floats`, the bytes of each case are its own encoded size
+ */
+template <class _Ty>
+void bench_xor_case(bench_runner &runner, const std::string &name, const std::vector<_Ty> &values)
+{
+    for (bool xor_floats : {false, true})
+    {
+        const auto prefix = "xor/" + name + (xor_floats ? "/xor" : "/dense");
+
+        std::vector<std::uint8_t> encoded{};
+        zeus::bytes_writer encoder{encoded};
+
+        encoder.set_xor_floats(xor_floats);
+
+        zeus::serialize_object(encoder, values);
+
+        const auto bytes = encoded.size();
+
+        std::vector<std::uint8_t> buffer{};
+
+        buffer.reserve(bytes);
+
+        runner.run(prefix + "/encode", bytes, [&]()
+                   {
+            buffer.clear();
+
+            zeus::bytes_writer writer{buffer};
+
+            writer.set_xor_floats(xor_floats);
+
+            zeus::serialize_object(writer, values);
+
+            do_not_optimize(buffer.data()); });
+
+        runner.run(prefix + "/decode", bytes, [&]()
+                   {
+            zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+            auto decoded = zeus::deserialize_object<std::vector<_Ty>>(reader);
+
+            do_not_optimize(decoded); });
+    }
+}
+
+/*
+ * Time series of a metrics snapshot: a gauge sampled at 2 decimals that mostly holds still, the same gauge as float,
+ * a counter rate with full precision noise and white noise
+ */
+void bench_xor_floats(bench_runner &runner)
+{
+    std::vector<double> gauge(1024 * 1024);
+    std::vector<float> gauge32(1024 * 1024);
+    std::vector<double> rate(1024 * 1024);
+    std::vector<double> noise(1024 * 1024);
+
+    std::mt19937_64 rng{42};
+    std::normal_distribution<double> normal{0.0, 1.0};
+
+    double level = 20.0;
+
+    for (std::size_t i = 0; i < gauge.size(); ++i)
+    {
+        /* the gauge moves by a step every 8 samples on average */
+        if (rng() % 8 == 0)
+            level += rng() % 2 ? 0.01 : -0.01;
+
+        gauge[i] = std::round(level * 100) / 100;
+        gauge32[i] = static_cast<float>(gauge[i]);
+        rate[i] = 1000.0 + 50.0 * std::sin(static_cast<double>(i) / 3600.0) + normal(rng);
+        noise[i] = normal(rng);
+    }
+
+    bench_xor_case(runner, "vector<double>/1M/gauge", gauge);
+    bench_xor_case(runner, "vector<float>/1M/gauge", gauge32);
+    bench_xor_case(runner, "vector<double>/1M/rate", rate);
+    bench_xor_case(runner, "vector<double>/1M/noise", noise);
+}
+
+/*
+ * Read one record of a large snapshot: open the flat layout in place against decoding the whole snapshot first
+ */
+void bench_flat(bench_runner &runner)
+{
+    using Record = std::tuple<uint64_t, std::string, std::vector<uint32_t>>;
+
+    std::vector<Record> records{};
+
+    for (uint32_t i = 0; i < 64 * 1024; ++i)
+        records.emplace_back(i, "record #" + std::to_string(i), std::vector<uint32_t>{i, i + 1, i + 2, i + 3});
+
+    auto encoded = zeus::serialize(records);
+    auto flat = zeus::serialize_flat(records);
+
+    runner.run("flat/64k/serialize", flat.size(), [&]()
+               {
+        auto buffer = zeus::serialize_flat(records);
+
+        do_not_optimize(buffer); });
+
+    runner.run("flat/64k/read_one/deserialize", encoded.size(), [&]()
+               {
+        auto decoded = zeus::deserialize<std::vector<Record>>(encoded);
+
+        do_not_optimize(std::get<2>(decoded[40000])[3]); });
+
+    runner.run("flat/64k/read_one/flat_view", flat.size(), [&]()
+               {
+        auto root = zeus::flat_root<std::vector<Record>>(flat.data(), flat.size());
+
+        do_not_optimize(root[40000].get<2>()[3].get()); });
+
+    runner.run("flat/64k/scan/flat_view", flat.size(), [&]()
+               {
+        auto root = zeus::flat_root<std::vector<Record>>(flat.data(), flat.size());
+
+        uint64_t sum = 0;
+
+        for (auto record : root)
+            sum += record.get<0>().get() + record.get<1>().view().size() + record.get<2>().size();
+
+        do_not_optimize(sum); });
+}
+
+/*
+ * Encode and decode an object in the oldest format version, to compare with the "<name>/encode" and "<name>/decode"
+ * cases of `bench_codec` which use the latest one
+ */
+template <class _Ty>
+void bench_format_oldest(bench_runner &runner, const std::string &name, const _Ty &object)
+{
+    std::vector<std::uint8_t> encoded{};
+    zeus::bytes_writer encoder{encoded};
+
+    encoder.set_format(zeus::VERSION_OLDEST);
+
+    zeus::serialize_object(encoder, object);
+
+    const auto bytes = encoded.size();
+
+    std::vector<std::uint8_t> buffer{};
+
+    buffer.reserve(bytes);
+
+    runner.run(name + "/encode_v0.1", bytes, [&]()
+               {
+        buffer.clear();
+
+        zeus::bytes_writer writer{buffer};
+
+        writer.set_format(zeus::VERSION_OLDEST);
+
+        zeus::serialize_object(writer, object);
+
+        do_not_optimize(buffer.data()); });
+
+    runner.run(name + "/decode_v0.1", bytes, [&]()
+               {
+        zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+        reader.set_format(zeus::VERSION_OLDEST);
+
+        auto decoded = zeus::deserialize_object<_Ty>(reader);
+
+        do_not_optimize(decoded); });
+}
+
+/*
+ * Encode and decode an object with a string table, to compare with the cases of `bench_codec` which write every
+ * string in full
+ */
+template <class _Ty>
+void bench_string_table(bench_runner &runner, const std::string &name, const _Ty &object)
+{
+    std::vector<std::uint8_t> encoded{};
+    zeus::string_table strings{};
+    zeus::bytes_writer encoder{encoded};
+
+    encoder.set_string_table(&strings);
+
+    zeus::serialize_object(encoder, object);
+
+    const auto bytes = encoded.size();
+
+    std::vector<std::uint8_t> buffer{};
+
+    buffer.reserve(bytes);
+
+    runner.run(name + "/encode_strings", bytes, [&]()
+               {
+        buffer.clear();
+        strings.clear();
+
+        zeus::bytes_writer writer{buffer};
+
+        writer.set_string_table(&strings);
+
+        zeus::serialize_object(writer, object);
+
+        do_not_optimize(buffer.data()); });
+
+    runner.run(name + "/decode_strings", bytes, [&]()
+               {
+        strings.clear();
+
+        zeus::bytes_reader_bounded reader{encoded.data(), encoded.size()};
+
+        reader.set_string_table(&strings);
+
+        auto decoded = zeus::deserialize_object<_Ty>(reader);
+
+        do_not_optimize(decoded); });
+}
+
+/*
+ * Persist a snapshot that changed by 1% as a delta, against writing it in full
+ */
+void bench_delta(bench_runner &runner)
+{
+    std::unordered_map<std::string, Profile> base{};
+
+    for (uint32_t i = 0; i < 64 * 1024; ++i)
+        base.emplace("profile #" + std::to_string(i), Profile{i, "user #" + std::to_string(i), 1700000000ull + i, {i, i + 1}, i * 0.25});
+
+    auto current = base;
+
+    for (uint32_t i = 0; i < 64 * 1024; i += 100)
+        current["profile #" + std::to_string(i)].score += 1;
+
+    const auto full = zeus::serialize(current).size();
+    const auto delta = zeus::serialize_delta(base, current);
+
+    runner.run("delta/unordered_map<string,Profile>/64k/serialize_full", full, [&]()
+               {
+        auto packed = zeus::serialize(current);
+
+        do_not_optimize(packed); });
+
+    runner.run("delta/unordered_map<string,Profile>/64k/serialize_delta", delta.size(), [&]()
+               {
+        auto packed = zeus::serialize_delta(base, current);
+
+        do_not_optimize(packed); });
+
+    auto patched = base;
+
+    runner.run("delta/unordered_map<string,Profile>/64k/apply_delta", delta.size(), [&]()
+               {
+        auto code = zeus::apply_delta(patched, delta);
+
+        do_not_optimize(code); });
+}
+
+/*
+ * Pack a snapshot into buffers the caller already owns: through a std::vector copied over against in place
+ */
+void bench_output_buffers(bench_runner &runner)
+{
+    std::vector<std::pair<uint64_t, std::string>> snapshot{};
+
+    for (uint64_t i = 0; i < 64 * 1024; ++i)
+        snapshot.emplace_back(i, "value of entry #" + std::to_string(i));
+
+    const auto bytes = zeus::serialize(snapshot).size();
+
+    std::string text{};
+    std::vector<std::uint8_t> region(bytes);
+
+    text.reserve(bytes);
+
+    runner.run("output/64k/string/serialize+copy", bytes, [&]()
+               {
+        auto packed = zeus::serialize(snapshot);
+
+        text.assign(packed.begin(), packed.end());
+
+        do_not_optimize(text.data()); });
+
+    runner.run("output/64k/string/serialize_into", bytes, [&]()
+               {
+        text.clear();
+
+        zeus::serialize_into(text, snapshot);
+
+        do_not_optimize(text.data()); });
+
+    runner.run("output/64k/pmr_vector<byte>/serialize_into", bytes, [&]()
+               {
+        std::pmr::monotonic_buffer_resource arena{bytes * 2};
+        std::pmr::vector<std::byte> packed{&arena};
+
+        zeus::serialize_into(packed, snapshot);
+
+        do_not_optimize(packed.data()); });
+
+    runner.run("output/64k/callback_buffer/serialize_into", bytes, [&]()
+               {
+        zeus::callback_buffer buffer{region.data(), region.size(), [](std::uint8_t *data, std::size_t, std::size_t)
+                                     { return std::pair<std::uint8_t *, std::size_t>{data, 0}; }};
+
+        zeus::serialize_into(buffer, snapshot);
+
+        do_not_optimize(buffer.data()); });
+}
+
+void bench_small_message(bench_runner &runner)
+{
+    SmallMessage message{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11.0, 12.0, 13.0f, 14.0f, 15, 16, 17, 18, 19, 20};
+    SmallMessageFields fields{message};
+
+    std::array<std::uint8_t, zeus::static_wire_size_v<SmallMessage>> buffer{};
+
+    runner.run("small_message/encode_bounded", buffer.size(), [&]()
+               {
+        zeus::bytes_writer_bounded writer{buffer.data(), buffer.size()};
+
+        writer << message;
+
+        do_not_optimize(buffer[writer.count() - 1]); });
+
+    runner.run("small_message/encode_bounded_per_field", buffer.size(), [&]()
+               {
+        zeus::bytes_writer_bounded writer{buffer.data(), buffer.size()};
+
+        writer << fields;
+
+        do_not_optimize(buffer[writer.count() - 1]); });
+
+    runner.run("small_message/decode_bounded", buffer.size(), [&]()
+               {
+        zeus::bytes_reader_bounded reader{buffer.data(), buffer.size()};
+
+        auto decoded = reader.read<SmallMessage>();
+
+        do_not_optimize(decoded); });
+
+    /* an IPC message of 64 bytes, packer header included, that is not of a fixed size */
+    using Message = std::tuple<uint64_t, std::string, std::vector<uint16_t>>;
+
+    Message ipc{42, "order.created.europe", {1, 2, 3, 4, 5, 6, 7, 8}};
+
+    const auto bytes = zeus::serialize(ipc).size();
+
+    runner.run("small_message/64B/serialize", bytes, [&]()
+               {
+        auto packed = zeus::serialize(ipc);
+
+        do_not_optimize(packed); });
+
+    runner.run("small_message/64B/serialize<256>", bytes, [&]()
+               {
+        auto packed = zeus::serialize<256>(ipc);
+
+        do_not_optimize(packed); });
+}
+
+/*
+ * Dump what the instrumentation collected over the whole run
+ */
+void print_stats()
+{
+    if (!zeus::stats::enabled)
+        return;
+
+    auto snapshot = zeus::stats::take_snapshot();
+
+    printf("\n%-10s %14s %16s %14s %14s %16s %14s\n", "data_type", "objects_w", "bytes_w", "cycles_w", "objects_r", "bytes_r", "cycles_r");
+
+    for (std::size_t i = 0; i < snapshot.data_types.size(); ++i)
+    {
+        auto &c = snapshot.data_types[i];
+
+        if (c.objects_written == 0 && c.objects_read == 0)
+            continue;
+
+        printf("%-10zu %14llu %16llu %14llu %14llu %16llu %14llu\n", i,
+               (unsigned long long)c.objects_written, (unsigned long long)c.bytes_written, (unsigned long long)c.cycles_written,
+               (unsigned long long)c.objects_read, (unsigned long long)c.bytes_read, (unsigned long long)c.cycles_read);
+    }
+
+    for (auto &t : snapshot.types)
+    {
+        printf("%-10s %14llu %16llu %14llu %14llu %16llu %14llu\n", t.name.c_str(),
+               (unsigned long long)t.values.objects_written, (unsigned long long)t.values.bytes_written, (unsigned long long)t.values.cycles_written,
+               (unsigned long long)t.values.objects_read, (unsigned long long)t.values.bytes_read, (unsigned long long)t.values.cycles_read);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    bool json = false;
+    double min_time = 0.5;
+    std::string filter{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+            min_time = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--filter <substring>] [--min-time <seconds>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench_runner runner{min_time, filter};
+
+    std::vector<uint32_t> scalars(16 * 1024);
+
+    for (std::size_t i = 0; i < scalars.size(); ++i)
+        scalars[i] = static_cast<uint32_t>(i * 2654435761u);
+
+    std::vector<std::string> strings{};
+    std::map<std::string, uint32_t> map{};
+
+    for (uint32_t i = 0; i < 1024; ++i)
+    {
+        strings.push_back("string value #" + std::to_string(i));
+        map.emplace("key #" + std::to_string(i), i);
+    }
+
+    std::vector<std::variant<uint32_t, double, std::string>> variants{};
+
+    for (uint32_t i = 0; i < 1024; ++i)
+    {
+        if (i % 3 == 0)
+            variants.emplace_back(i);
+        else if (i % 3 == 1)
+            variants.emplace_back(i * 0.5);
+        else
+            variants.emplace_back(std::to_string(i));
+    }
+
+    std::vector<std::tuple<std::string, uint32_t, std::string, uint32_t>> tuples(
+        1024, std::tuple<std::string, uint32_t, std::string, uint32_t>{"192.168.10.1", 3768, "202.113.76.68", 80});
+
+    Complicated complicated{};
+
+    complicated.name = L"jacky";
+
+    for (uint32_t i = 0; i < 256; ++i)
+        complicated.map.emplace(i, Row{static_cast<uint16_t>(i), {1, 2, 3, 4, 5, 6, 7, 8}});
+
+    bench_codec(runner, "vector<uint32_t>/16k", scalars);
+
+    std::array<uint32_t, 256> fixed_scalars{};
+
+    std::copy_n(scalars.begin(), fixed_scalars.size(), fixed_scalars.begin());
+
+    bench_codec(runner, "array<uint32_t,256>", fixed_scalars);
+    bench_codec(runner, "vector<string>/1k", strings);
+    bench_codec(runner, "map<string,uint32_t>/1k", map);
+
+    std::map<uint64_t, uint64_t> large_map{};
+    std::unordered_map<uint64_t, uint64_t> large_unordered_map{};
+
+    for (uint64_t i = 0; i < 256 * 1024; ++i)
+    {
+        large_map.emplace(i * 7, i);
+        large_unordered_map.emplace(i * 7, i);
+    }
+
+    bench_codec(runner, "map<uint64_t,uint64_t>/256k", large_map);
+    bench_codec(runner, "unordered_map<uint64_t,uint64_t>/256k", large_unordered_map);
+    bench_codec(runner, "vector<variant>/1k", variants);
+    bench_codec(runner, "vector<tuple>/1k", tuples);
+
+    std::vector<Counted> counted{};
+    std::map<Counted, Counted> counted_map{};
+    std::vector<std::tuple<Counted, std::vector<Counted>>> counted_tuples{};
+
+    for (uint32_t i = 0; i < 1024; ++i)
+    {
+        counted.emplace_back("counted value #" + std::to_string(i));
+        counted_map.emplace(Counted{"key #" + std::to_string(i)}, Counted{"value #" + std::to_string(i)});
+        counted_tuples.emplace_back(Counted{"name"}, std::vector<Counted>{Counted{"a"}, Counted{"b"}});
+    }
+
+    bench_codec(runner, "vector<Counted>/1k", counted);
+    bench_codec(runner, "map<Counted,Counted>/1k", counted_map);
+    bench_codec(runner, "vector<tuple<Counted,vector>>/1k", counted_tuples);
+
+    bench_format_oldest(runner, "vector<variant>/1k", variants);
+    bench_format_oldest(runner, "vector<tuple>/1k", tuples);
+    bench_codec(runner, "Complicated/256", complicated);
+
+    std::vector<Profile> profiles{};
+    std::vector<ProfileRecord> profile_records{};
+
+    for (uint32_t i = 0; i < 1024; ++i)
+    {
+        profiles.push_back(Profile{i, "user #" + std::to_string(i), 1700000000ull + i, {i, i + 1, i + 2}, i * 0.25});
+        profile_records.push_back(ProfileRecord{profiles.back()});
+    }
+
+    bench_codec(runner, "Profile/positional/1k", profiles);
+    bench_codec(runner, "Profile/record/1k", profile_records);
+
+    std::vector<ProfileFields> profile_fields{};
+
+    for (auto &profile : profiles)
+        profile_fields.push_back(ProfileFields{profile.id, profile.name, profile.created, profile.groups, profile.score});
+
+    bench_codec(runner, "Profile/aggregate/1k", profile_fields);
+
+    std::vector<Tick> ticks(64 * 1024);
+    std::vector<PackedTick> packed_ticks(ticks.size());
+
+    for (std::size_t i = 0; i < ticks.size(); ++i)
+    {
+        ticks[i] = Tick{static_cast<uint8_t>(i & 1), 10000 + i % 500, static_cast<uint32_t>(i % 1000)};
+        packed_ticks[i] = PackedTick{ticks[i].side, ticks[i].price, ticks[i].quantity};
+    }
+
+    bench_codec(runner, "vector<Tick>/64k", ticks);
+    bench_codec(runner, "vector<Tick>/packed/64k", packed_ticks);
+
+    /* a rule-match mask, against the same flags stored one byte each */
+    std::vector<bool> mask(8 * 1024 * 1024);
+    std::vector<uint8_t> mask_bytes(mask.size());
+
+    for (std::size_t i = 0; i < mask.size(); ++i)
+        mask_bytes[i] = mask[i] = (i * 2654435761u >> 7) & 1;
+
+    bench_codec(runner, "vector<bool>/8M", mask);
+    bench_codec(runner, "vector<uint8_t>/8M", mask_bytes);
+
+    std::vector<std::map<std::string, std::string>> events{};
+
+    for (uint32_t i = 0; i < 4096; ++i)
+    {
+        events.push_back({{"user", "user #" + std::to_string(i % 200)},
+                          {"rule", "rule-" + std::to_string(i % 50)},
+                          {"path", "/var/lib/service/" + std::to_string(i % 16) + "/events.log"}});
+    }
+
+    bench_codec(runner, "events/4k", events);
+    bench_string_table(runner, "events/4k", events);
+
+    bench_delta(runner);
+    bench_chunked(runner);
+    bench_flat(runner);
+    bench_aligned(runner);
+    bench_sparse(runner);
+    bench_xor_floats(runner);
+    bench_output_buffers(runner);
+    bench_small_message(runner);
+    bench_checksums(runner);
+
+    if (json)
+    {
+        runner.print_json();
+    }
+    else
+    {
+        runner.print_table();
+
+        print_stats();
+    }
+
+    return 0;
+}
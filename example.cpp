@@ -1,4 +1,6 @@
+#include <cmath>
 #include <list>
+#include <map>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -8,6 +10,7 @@
 #include <queue>
 
 #include "zpacker.hpp"
+#include "zpacker_flat.hpp"
 
 struct Row
 {
@@ -159,14 +162,28 @@ void array_example()
 
     auto bin1 = zeus::serialize(arr1);
 
-    // this is an error, std::array can not be dynamically construct
-    // auto object = zeus::deserialize<decltype(arr1)>(bin1);
-
-    /* deserialize into a std::vector<int> */
-    auto object = zeus::deserialize<std::vector<int>>(bin1);
+    /* decoded on the stack, the length on the wire must match the size of the array */
+    auto object = zeus::deserialize<decltype(arr1)>(bin1);
 
     std::for_each(object.begin(), object.end(), [](const auto &v)
                   { printf("value = %d\n", v); });
+
+    /* the same data can also be deserialized into a std::vector<int> */
+    auto vec = zeus::deserialize<std::vector<int>>(bin1);
+
+    /* a std::array of another size is rejected */
+    auto result = zeus::try_deserialize<std::array<int, 4>>(bin1);
+
+    printf("array<int, 4>: error = %d\n", static_cast<int>(result.error()));
+
+    /* elements that are not trivially copyable are decoded one by one */
+    std::tuple<std::array<std::string, 2>, uint32_t> names{{"jacky", "lucy"}, 2};
+
+    auto bin2 = zeus::serialize(names);
+
+    auto names2 = zeus::deserialize<decltype(names)>(bin2);
+
+    printf("names: %s, %s\n", std::get<0>(names2)[0].c_str(), std::get<0>(names2)[1].c_str());
 }
 
 void forward_list_example()
@@ -230,6 +247,19 @@ void get_size_example()
     auto size4 = zeus::get_size<decltype(var4)>(var4);
 
     printf("size1 = %zd, size2 = %zd, size3 = %zd, size4 = %zd\n", size1, size2, size3, size4);
+
+    /* the size of fixed-size types is known at compile time, so they can be encoded into a stack buffer */
+    using Point = std::tuple<int, double, std::array<float, 3>>;
+
+    static_assert(zeus::is_fixed_wire_size_v<Point>, "Point must have a static wire size");
+
+    std::array<uint8_t, zeus::static_wire_size_v<Point>> stack_buffer{};
+
+    zeus::bytes_writer_bounded writer{stack_buffer.data(), stack_buffer.size()};
+
+    writer << Point{1, 2.0, {3.0f, 4.0f, 5.0f}};
+
+    printf("static size = %zd, written = %zd\n", zeus::static_wire_size_v<Point>, writer.count());
 }
 
 void test_multi_map()
@@ -281,7 +311,423 @@ void custom_type_example()
     auto object = zeus::deserialize<decltype(custom)>(data);
 }
 
-int main(int argc, char const *argv[])
+void batch_example()
+{
+    std::vector<std::tuple<uint32_t, std::string>> events{{1, "login"}, {2, "open"}, {3, "close"}, {4, "logout"}};
+
+    /* pack all the events into a single arena, encoding is fanned out across 2 threads */
+    auto batch = zeus::serialize_batch(events, zeus::crc32_checksum{}, 2);
+
+    auto objects = zeus::deserialize_batch<decltype(events)::value_type>(batch, zeus::crc32_checksum{});
+
+    std::for_each(objects.begin(), objects.end(), [](const auto &v)
+                  { printf("event %u: %s\n", std::get<0>(v), std::get<1>(v).c_str()); });
+}
+
+void error_example()
+{
+    auto data = zeus::serialize(std::vector<int>{1, 2, 3}, zeus::crc32_checksum{});
+
+    /* corrupt the payload */
+    data.back() ^= 0xff;
+
+    /* unlike `deserialize`, a failure is not folded into an empty object */
+    auto result = zeus::try_deserialize<std::vector<int>>(data, zeus::crc32_checksum{});
+
+    if (!result)
+        printf("deserialize failed, error = %d, offset = %zd\n", static_cast<int>(result.error()), result.error_offset());
+}
+
+void skip_example()
+{
+    std::vector<uint8_t> buffer;
+    zeus::bytes_writer writer{buffer};
+
+    writer << std::vector<std::string>{"large", "field", "we", "don't", "need"} << std::string{"wanted"};
+
+    zeus::bytes_reader reader{buffer};
+
+    /* skip the first field without decoding it */
+    zeus::skip_object<std::vector<std::string>>(reader);
+
+    printf("second field = %s\n", reader.read<std::string>().c_str());
+
+    /* validate untrusted packed data in one pass before decoding it */
+    auto packed = zeus::serialize(std::vector<std::vector<int>>{{1, 2}, {3}});
+
+    printf("valid = %d\n", zeus::validate<std::vector<std::vector<int>>>(packed) == zeus::error_code::none);
+
+    /* print the structure of the payload */
+    printf("%s", zeus::dump(packed.data() + sizeof(zeus::packer_header), packed.size() - sizeof(zeus::packer_header)).c_str());
+}
+
+/* two versions of the same type, the second one drops `age` and adds `tags` */
+struct ProfileV1
+{
+    uint32_t id;
+    std::string name;
+    uint8_t age;
+
+    std::size_t get_size() const
+    {
+        return zeus::get_record_size(zeus::field(1, id), zeus::field(2, name), zeus::field(3, age));
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, ProfileV1>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        zeus::write_record(writer, zeus::field(1, id), zeus::field(2, name), zeus::field(3, age));
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, ProfileV1>, int> = 0>
+    static ProfileV1 deserialize(_Reader &reader)
+    {
+        ProfileV1 self{};
+
+        zeus::read_record(reader, zeus::field(1, self.id), zeus::field(2, self.name), zeus::field(3, self.age));
+
+        return self;
+    }
+};
+
+struct ProfileV2
+{
+    uint32_t id;
+    std::string name;
+    std::vector<std::string> tags{"default"};
+
+    std::size_t get_size() const
+    {
+        return zeus::get_record_size(zeus::field(1, id), zeus::field(2, name), zeus::field(4, tags));
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, ProfileV2>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        zeus::write_record(writer, zeus::field(1, id), zeus::field(2, name), zeus::field(4, tags));
+    }
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, ProfileV2>, int> = 0>
+    static ProfileV2 deserialize(_Reader &reader)
+    {
+        ProfileV2 self{};
+
+        zeus::read_record(reader, zeus::field(1, self.id), zeus::field(2, self.name), zeus::field(4, self.tags));
+
+        return self;
+    }
+};
+
+void record_example()
+{
+    /* an old writer, a new reader: `age` is skipped, `tags` keeps its default */
+    auto old_data = zeus::serialize(std::vector<ProfileV1>{{1, "jacky", 30}, {2, "lucy", 25}});
+
+    auto profiles = zeus::deserialize<std::vector<ProfileV2>>(old_data);
+
+    std::for_each(profiles.begin(), profiles.end(), [](const auto &v)
+                  { printf("profile %u: %s, %s\n", v.id, v.name.c_str(), v.tags.front().c_str()); });
+
+    /* a new writer, an old reader: `tags` is skipped, `age` keeps its default */
+    auto new_data = zeus::serialize(ProfileV2{3, "tom", {"admin", "ops"}});
+
+    auto old_profile = zeus::deserialize<ProfileV1>(new_data);
+
+    printf("profile %u: %s, age %u\n", old_profile.id, old_profile.name.c_str(), old_profile.age);
+
+    printf("%s", zeus::dump(new_data.data() + sizeof(zeus::packer_header), new_data.size() - sizeof(zeus::packer_header)).c_str());
+}
+
+/* a type without a default constructor, decoded through its constructor hook */
+struct Endpoint
+{
+    Endpoint(std::string host, uint16_t port) : host(std::move(host)), port(port) {}
+
+    template <class _Reader, std::enable_if_t<zeus::is_reader_v<_Reader, std::string>, int> = 0>
+    Endpoint(zeus::deserialize_tag_t, _Reader &reader)
+        : host(reader.template read<std::string>()), port(reader.template read<uint16_t>())
+    {
+    }
+
+    std::string host;
+    uint16_t port;
+
+    std::size_t get_size() const
+    {
+        return zeus::get_size(host) + zeus::get_size(port);
+    }
+
+    template <class _Writer, std::enable_if_t<zeus::is_writer_v<_Writer, Endpoint>, int> = 0>
+    void serialize(_Writer &writer) const
+    {
+        writer << host << port;
+    }
+};
+
+void construct_example()
+{
+    std::map<std::string, Endpoint> endpoints{{"primary", {"10.0.0.1", 80}}, {"backup", {"10.0.0.2", 8080}}};
+
+    auto data = zeus::serialize(endpoints);
+
+    /* keys and endpoints are constructed in the nodes of the map, `deserialize` needs a default constructor */
+    auto result = zeus::try_deserialize<decltype(endpoints)>(data);
+
+    std::for_each(result->begin(), result->end(), [](const auto &v)
+                  { printf("%s = %s:%u\n", v.first.c_str(), v.second.host.c_str(), v.second.port); });
+
+    /* decode into an existing vector, its capacity is reused */
+    std::vector<std::string> names{};
+
+    names.reserve(16);
+
+    auto packed = zeus::serialize(std::vector<std::string>{"jacky", "lucy"});
+
+    zeus::bytes_reader reader{packed};
+
+    reader.skip(sizeof(zeus::packer_header));
+
+    zeus::deserialize_object_into(reader, names);
+
+    printf("names: %zu, capacity %zu\n", names.size(), names.capacity());
+}
+
+void string_table_example()
+{
+    std::vector<std::map<std::string, std::string>> events{};
+
+    for (int i = 0; i < 100; ++i)
+        events.push_back({{"user", i % 2 ? "jacky" : "lucy"}, {"rule", "deny-" + std::to_string(i % 3)}});
+
+    /* repeated strings are written once, later occurrences refer to the first one */
+    std::vector<uint8_t> data{};
+    zeus::string_table written{};
+    zeus::bytes_writer writer{data};
+
+    writer.set_string_table(&written);
+
+    zeus::serialize_object(writer, events);
+
+    /* the reader needs a table too, it keeps views into `data` */
+    zeus::string_table read{};
+    zeus::bytes_reader reader{data};
+
+    reader.set_string_table(&read);
+
+    auto result = zeus::deserialize_object<decltype(events)>(reader);
+
+    printf("string table: %zu bytes, %zu strings, decoded %s\n", data.size(), read.size(),
+           reader.good() && result == events ? "ok" : "failed");
+}
+
+void delta_example()
+{
+    std::map<std::string, uint32_t> base{{"jacky", 1}, {"lucy", 2}, {"tom", 3}};
+    std::map<std::string, uint32_t> current{{"jacky", 1}, {"lucy", 5}, {"lily", 4}};
+
+    auto snapshot = zeus::serialize(base);
+
+    /* only "lucy" and "lily" are written, "tom" is recorded as removed */
+    auto delta = zeus::serialize_delta(base, current);
+
+    auto patched = base;
+
+    auto code = zeus::apply_delta(patched, delta);
+
+    printf("delta: %zu bytes against a %zu bytes snapshot, patched %s\n", delta.size(), snapshot.size(),
+           code == zeus::error_code::none && patched == current ? "ok" : "failed");
+
+    /* fold the chain into a new snapshot once in a while */
+    zeus::compact_deltas<decltype(base)>(snapshot, {delta});
+
+    printf("compacted: %s\n", zeus::deserialize<decltype(base)>(snapshot) == current ? "ok" : "failed");
+
+    /* trivially copyable elements are stored as they are, padding between key and value included */
+    std::map<uint8_t, uint32_t> levels{{1, 10}, {2, 20}, {3, 30}};
+    std::map<uint8_t, uint32_t> next_levels{{1, 10}, {2, 25}, {4, 40}};
+
+    auto patched_levels = levels;
+
+    code = zeus::apply_delta(patched_levels, zeus::serialize_delta(levels, next_levels));
+
+    printf("padded delta: %s\n", code == zeus::error_code::none && patched_levels == next_levels ? "ok" : "failed");
+}
+
+void chunked_example()
+{
+    std::vector<std::string> lines{};
+
+    for (int i = 0; i < 100000; ++i)
+        lines.push_back("line #" + std::to_string(i));
+
+    auto blob = zeus::serialize_chunked(lines);
+
+    /* verify only the chunks a read touches */
+    zeus::chunk_table table{};
+
+    auto code = table.parse(blob.data(), blob.size());
+
+    if (code == zeus::error_code::none)
+        code = table.verify(table.payload_size() / 2, 1024);
+
+    printf("chunked: %zu chunks, verify %s\n", table.chunks().size(), code == zeus::error_code::none ? "ok" : "failed");
+
+    /* or verify all of them in parallel and decode */
+    auto result = zeus::deserialize_chunked<decltype(lines)>(blob.data(), blob.size(), 4);
+
+    printf("chunked: decoded %s\n", result && *result == lines ? "ok" : "failed");
+}
+
+void aligned_example()
+{
+    std::vector<double> samples{0.5, 1.5, 2.5, 3.5};
+
+    /* pad the samples to the alignment of double, relative to the start of the buffer */
+    auto buffer = zeus::serialize_aligned(samples);
+
+    zeus::bytes_reader_bounded reader{buffer.data() + sizeof(zeus::packer_header), buffer.size() - sizeof(zeus::packer_header)};
+
+    /* the samples are handed out in place, a buffer that is not aligned for them reports error_code::misaligned */
+    auto view = zeus::read_array_view<double>(reader);
+
+    printf("aligned: %zu samples in place, last %.1f, %s\n", view.size(), view.empty() ? 0.0 : view[view.size() - 1],
+           reader.good() ? "ok" : "failed");
+}
+
+void flat_example()
+{
+    /* id, name, samples per channel */
+    using Recording = std::tuple<uint32_t, std::string, std::map<std::string, std::vector<float>>>;
+
+    Recording recording{42, "bench #1", {{"left", {0.5f, 0.25f}}, {"right", {1.0f, 0.75f, 0.5f}}}};
+
+    auto buffer = zeus::serialize_flat(recording);
+
+    /* the buffer may as well be a mmapped file, fields are read in place */
+    auto root = zeus::flat_root<Recording>(buffer.data(), buffer.size());
+
+    if (!root)
+        return;
+
+    auto channel = root.get<2>().find(std::string_view{"right"});
+
+    printf("flat: %u %s, right: %zu samples, first %.2f\n", root.get<0>().get(), std::string{root.get<1>().view()}.c_str(),
+           channel ? channel.second().size() : 0, channel ? channel.second()[0].get() : 0.0f);
+}
+
+/* no constructors and no serialization methods: the fields are enumerated */
+struct Employee
+{
+    uint32_t id;
+    std::string name;
+    std::vector<std::string> skills;
+};
+
+/* trivially copyable with 7 bytes of padding, written without them */
+struct Quote
+{
+    uint8_t side;
+    uint64_t price;
+    uint32_t quantity;
+};
+
+template <>
+inline constexpr bool zeus::pack_fields_v<Quote> = true;
+
+void aggregate_example()
+{
+    std::vector<Employee> employees{{1, "Alice", {"c++", "sql"}}, {2, "Bob", {"rust"}}};
+
+    auto data = zeus::serialize(employees);
+
+    auto objects = zeus::deserialize<decltype(employees)>(data);
+
+    std::vector<Quote> quotes{{0, 10150, 200}, {1, 10175, 50}};
+
+    printf("aggregate: %zu employees, %s knows %s, %zu quotes in %zu bytes instead of %zu\n", objects.size(),
+           objects[0].name.c_str(), objects[0].skills[0].c_str(), quotes.size(), zeus::get_size(quotes),
+           sizeof(zeus::data_header) + quotes.size() * sizeof(Quote));
+}
+
+void bits_example()
+{
+    std::vector<bool> mask(1000);
+
+    for (std::size_t i = 0; i < mask.size(); i += 3)
+        mask[i] = true;
+
+    /* 1 bit per element: 125 bytes behind the data header */
+    auto data = zeus::serialize(mask);
+
+    auto object = zeus::deserialize<decltype(mask)>(data);
+
+    printf("bits: %zu flags in %zu bytes, %s\n", object.size(), data.size() - sizeof(zeus::packer_header),
+           object == mask ? "ok" : "failed");
+}
+
+void sparse_example()
+{
+    /* a histogram with a few non-zero buckets */
+    std::vector<uint32_t> histogram(4096);
+
+    histogram[17] = 3;
+    histogram[1024] = 42;
+
+    /* blocks of 256 buckets are stored as their non-zero buckets with their indices */
+    auto data = zeus::serialize_sparse(histogram);
+
+    auto object = zeus::deserialize<decltype(histogram)>(data);
+
+    printf("sparse: %zu buckets in %zu bytes instead of %zu, %s\n", object.size(), data.size(), zeus::serialize(histogram).size(),
+           object == histogram ? "ok" : "failed");
+}
+
+void xor_floats_example()
+{
+    /* a temperature sampled every second to a hundredth of a degree, it drifts slowly */
+    std::vector<double> samples(3600);
+
+    for (std::size_t i = 0; i < samples.size(); ++i)
+        samples[i] = std::round((21.5 + std::sin(static_cast<double>(i) / 600)) * 100) / 100;
+
+    /* every sample is XORed with the one before it, repeated samples take a bit */
+    auto data = zeus::serialize_xor_floats(samples);
+
+    auto object = zeus::deserialize<decltype(samples)>(data);
+
+    printf("xor floats: %zu samples in %zu bytes instead of %zu, %s\n", object.size(), data.size(), zeus::serialize(samples).size(),
+           object == samples ? "ok" : "failed");
+}
+
+void small_buffer_example()
+{
+    std::tuple<uint64_t, std::string> message{7, "ping"};
+
+    /* up to 256 bytes stay on the stack, larger messages move to the heap */
+    auto data = zeus::serialize<256>(message);
+
+    auto object = zeus::deserialize<decltype(message)>(data.data(), data.size());
+
+    printf("small buffer: %zu bytes %s, %s\n", data.size(), data.on_heap() ? "on the heap" : "inline",
+           object == message ? "ok" : "failed");
+}
+
+void output_buffer_example()
+{
+    /* a buffer owned by the caller, e.g. the pending output of a connection, already holding a line */
+    std::string pending = "HELLO\n";
+
+    std::map<std::string, uint32_t> scores{{"Jacky", 68}, {"Bob", 45}};
+
+    /* the packed bytes are appended in place, behind what the buffer already holds */
+    auto code = zeus::serialize_into(pending, scores);
+
+    auto object = zeus::deserialize<decltype(scores)>(pending.data() + 6, pending.size() - 6);
+
+    printf("output buffer: %zu bytes, %s\n", pending.size(), code == zeus::error_code::none && object == scores ? "ok" : "failed");
+}
+
+int main()
 {
     array_example();
     forward_list_example();
@@ -296,5 +742,37 @@ int main(int argc, char const *argv[])
 
     test_multi_map();
 
+    batch_example();
+
+    error_example();
+
+    skip_example();
+
+    record_example();
+
+    construct_example();
+
+    string_table_example();
+
+    delta_example();
+
+    chunked_example();
+
+    flat_example();
+
+    aligned_example();
+
+    aggregate_example();
+
+    bits_example();
+
+    sparse_example();
+
+    xor_floats_example();
+
+    small_buffer_example();
+
+    output_buffer_example();
+
     return 0;
 }
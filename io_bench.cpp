@@ -0,0 +1,142 @@
+/*
+ * Benchmark of zpacker_io.hpp: save and load a snapshot through io_uring against the synchronous path
+ *
+ *   zpacker_io_bench [directory...]
+ *
+ * Every directory is benchmarked, /dev/shm (tmpfs) and /tmp by default. The synchronous path is `serialize` followed
+ * by write(), respectively read() followed by `deserialize`.
+ */
+
+#include "zpacker_io.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using Snapshot = std::vector<std::pair<uint64_t, std::string>>;
+
+static double best_seconds(const std::function<bool()> &fn)
+{
+    double best = 0;
+
+    for (int round = 0; round < 5; ++round)
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        if (!fn())
+            return -1;
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        if (round == 0 || seconds < best)
+            best = seconds;
+    }
+
+    return best;
+}
+
+static bool save_sync(const char *path, const Snapshot &snapshot)
+{
+    auto data = zeus::serialize(snapshot);
+    auto fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+        return false;
+
+    auto written = ::write(fd, data.data(), data.size());
+
+    return ::close(fd) == 0 && written == static_cast<ssize_t>(data.size());
+}
+
+static bool load_sync(const char *path, const Snapshot &expected)
+{
+    auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    struct stat st
+    {
+    };
+
+    ::fstat(fd, &st);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(st.st_size));
+
+    auto read = ::read(fd, data.data(), data.size());
+
+    ::close(fd);
+
+    return read == static_cast<ssize_t>(data.size()) && zeus::deserialize<Snapshot>(data).size() == expected.size();
+}
+
+int main(int argc, char const *argv[])
+{
+    std::vector<std::string> directories{};
+
+    for (int i = 1; i < argc; ++i)
+        directories.push_back(argv[i]);
+
+    if (directories.empty())
+        directories = {"/dev/shm", "/tmp"};
+
+    Snapshot snapshot{};
+
+    for (uint64_t i = 0; i < 2 * 1024 * 1024; ++i)
+        snapshot.emplace_back(i, "value of entry #" + std::to_string(i));
+
+    const auto bytes = zeus::serialize(snapshot).size();
+
+    zeus::file_options pwrite{};
+    zeus::file_options uring{};
+    zeus::file_options direct{};
+
+    pwrite.uring = false;
+    direct.direct = true;
+
+    printf("snapshot: %.1f MB\n", bytes / (1024.0 * 1024.0));
+    printf("%-40s %12s %12s\n", "benchmark", "ms", "MB/s");
+
+    for (auto &directory : directories)
+    {
+        auto path = directory + "/zpacker_io_bench.snapshot";
+
+        auto report = [&](const char *name, const std::function<bool()> &fn)
+        {
+            auto seconds = best_seconds(fn);
+            auto label = directory + " " + name;
+
+            if (seconds < 0)
+                printf("%-40s %12s\n", label.c_str(), "failed");
+            else
+                printf("%-40s %12.2f %12.2f\n", label.c_str(), seconds * 1e3, bytes / seconds / (1024.0 * 1024.0));
+        };
+
+        report("save/sync", [&]()
+               { return save_sync(path.c_str(), snapshot); });
+
+        report("save/pwrite", [&]()
+               { return zeus::save_snapshot(path.c_str(), snapshot, pwrite) == zeus::error_code::none; });
+
+        report("save/io_uring", [&]()
+               { return zeus::save_snapshot(path.c_str(), snapshot, uring) == zeus::error_code::none; });
+
+        report("save/io_uring+O_DIRECT", [&]()
+               { return zeus::save_snapshot(path.c_str(), snapshot, direct) == zeus::error_code::none; });
+
+        report("load/sync", [&]()
+               { return load_sync(path.c_str(), snapshot); });
+
+        report("load/io_uring", [&]()
+               { return zeus::load_snapshot<Snapshot>(path.c_str(), uring).has_value(); });
+
+        report("load/io_uring+O_DIRECT", [&]()
+               { return zeus::load_snapshot<Snapshot>(path.c_str(), direct).has_value(); });
+
+        ::unlink(path.c_str());
+    }
+
+    return 0;
+}
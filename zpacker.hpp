@@ -7,6 +7,34 @@
 #include <variant>
 #include <vector>
 #include <numeric>
+#include <cstring>
+#include <cstddef>
+#include <thread>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <unordered_map>
+#include <cstdio>
+#include <memory>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(ZPACKER_ENABLE_STATS)
+#include <chrono>
+#include <mutex>
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+#endif
 
 #define _REQUIRE_READER(__x, __y) std::enable_if_t<zeus::is_reader_v<__x, __y>, int> = 0
 
@@ -18,7 +46,7 @@ namespace zeus
     inline constexpr bool Always_false = false;
 
     constexpr std::uint16_t VERSION_MAJOR = 0x0;
-    constexpr std::uint16_t VERSION_MINOR = 0x1;
+    constexpr std::uint16_t VERSION_MINOR = 0x7;
 
     constexpr std::uint16_t make_version(std::uint16_t major, std::uint16_t minor)
     {
@@ -27,6 +55,27 @@ namespace zeus
 
     constexpr std::uint16_t VERSION = make_version(VERSION_MAJOR, VERSION_MINOR);
 
+    /* oldest format version that can still be read */
+    constexpr std::uint16_t VERSION_OLDEST = make_version(0x0, 0x1);
+
+    /* first format version that stores variants with a one-byte index and tuples without a header */
+    constexpr std::uint16_t VERSION_COMPACT = make_version(0x0, 0x2);
+
+    /* first format version that flags associative containers whose elements are stored in key order */
+    constexpr std::uint16_t VERSION_ORDERED = make_version(0x0, 0x3);
+
+    /* first format version that can pad arrays of trivially copyable elements to their alignment, see `set_aligned` */
+    constexpr std::uint16_t VERSION_ALIGNED = make_version(0x0, 0x4);
+
+    /* first format version that packs std::vector<bool> 8 elements per byte */
+    constexpr std::uint16_t VERSION_BITS = make_version(0x0, 0x5);
+
+    /* first format version that can store sequences of scalars in sparse or run-length blocks, see `set_sparse` */
+    constexpr std::uint16_t VERSION_SPARSE = make_version(0x0, 0x6);
+
+    /* first format version that can store blocks of floating point numbers XORed with their predecessor, see `set_xor_floats` */
+    constexpr std::uint16_t VERSION_XOR = make_version(0x0, 0x7);
+
     /* check if a type is a specialization of a template with single type and extract the single type of template */
     template <typename _Type, template <class...> typename _Template>
     struct is_specialize_of : std::false_type
@@ -61,7 +110,11 @@ namespace zeus
     inline constexpr bool is_specialize_of_v<_Template<_Types...>, _Template> = true;
 
     class bytes_reader;
-    class bytes_writer;
+
+    template <class _Buffer>
+    class basic_bytes_writer;
+
+    using bytes_writer = basic_bytes_writer<std::vector<std::uint8_t>>;
 
     class bytes_reader_bounded;
     class bytes_writer_bounded;
@@ -121,6 +174,12 @@ namespace zeus
         template <class _Ty>
         std::false_type has_reserve_impl(...);
 
+        template <class _Ty>
+        auto has_resize_impl(int) -> decltype(std::declval<_Ty>().resize(0), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_resize_impl(...);
+
         template <class _Ty>
         auto has_serialize1_impl(int) -> decltype(std::declval<_Ty>().serialize(std::declval<std::add_lvalue_reference_t<bytes_writer>>()), std::true_type{});
 
@@ -172,6 +231,60 @@ namespace zeus
 
         template <class _Ty, class _Vty>
         std::false_type is_writer_impl(...);
+
+        template <class _Ty>
+        auto has_emplace_back_impl(int) -> decltype(std::declval<_Ty>().emplace_back(), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_emplace_back_impl(...);
+
+        template <class _Ty>
+        auto has_emplace_impl(int) -> decltype(std::declval<_Ty>().emplace(std::declval<typename _Ty::value_type>()), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_emplace_impl(...);
+
+        template <class _Ty>
+        auto has_mapped_type_impl(int) -> decltype(std::declval<typename _Ty::mapped_type>(), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_mapped_type_impl(...);
+
+        template <class _Ty>
+        auto has_key_compare_impl(int) -> decltype(std::declval<typename _Ty::key_compare>(), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_key_compare_impl(...);
+
+        template <class _Ty>
+        auto has_reserve_bytes_impl(int) -> decltype(std::declval<_Ty>().reserve_bytes(std::size_t{}), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_reserve_bytes_impl(...);
+
+        template <class _Ty>
+        auto has_consume_bytes_impl(int) -> decltype(std::declval<_Ty>().consume_bytes(std::size_t{}), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_consume_bytes_impl(...);
+
+        template <class _Ty>
+        auto has_write_bytes_impl(int) -> decltype(std::declval<_Ty>().write(std::declval<const std::uint8_t *>(), std::size_t{}), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_write_bytes_impl(...);
+
+        template <class _Ty>
+        auto has_overwrite_impl(int) -> decltype(std::declval<_Ty>().overwrite(std::size_t{}, std::declval<const void *>(), std::size_t{}), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_overwrite_impl(...);
+
+        template <class _Ty>
+        auto has_data_impl(int) -> decltype(std::declval<const _Ty &>().data(), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_data_impl(...);
     }
 
     template <class _Ty>
@@ -228,6 +341,12 @@ namespace zeus
     template <class _Ty>
     constexpr bool has_reserve_v = has_reserve<_Ty>::value;
 
+    template <class _Ty>
+    using has_resize = decltype(detail::has_resize_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_resize_v = has_resize<_Ty>::value;
+
     template <class _Ty>
     using has_serialize_unbounded = decltype(detail::has_serialize1_impl<_Ty>(0));
 
@@ -282,6 +401,88 @@ namespace zeus
     template <class _Ty, class _Vty>
     constexpr bool is_writer_v = is_writer<_Ty, _Vty>::value;
 
+    template <class _Ty>
+    using has_emplace_back = decltype(detail::has_emplace_back_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_emplace_back_v = has_emplace_back<_Ty>::value;
+
+    template <class _Ty>
+    using has_emplace = decltype(detail::has_emplace_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_emplace_v = has_emplace<_Ty>::value;
+
+    template <class _Ty>
+    using has_mapped_type = decltype(detail::has_mapped_type_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_mapped_type_v = has_mapped_type<_Ty>::value;
+
+    /* std::map, std::set and the like, their elements are iterated in key order */
+    template <class _Ty>
+    using has_key_compare = decltype(detail::has_key_compare_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_key_compare_v = has_key_compare<_Ty>::value;
+
+    /*
+     * Tag of the constructor hook `_Ty(zeus::deserialize_tag_t, _Reader &reader)`, an alternative to the static
+     * `deserialize` method for types that are not default constructible
+     */
+    struct deserialize_tag_t
+    {
+        explicit deserialize_tag_t() = default;
+    };
+
+    inline constexpr deserialize_tag_t deserialize_tag{};
+
+    template <class _Ty, class _Reader>
+    constexpr bool has_deserialize_constructor_v = std::is_constructible_v<_Ty, deserialize_tag_t, _Reader &>;
+
+    namespace detail
+    {
+        template <class _Ty, class _Reader>
+        constexpr bool is_deserializable_v =
+            std::is_default_constructible_v<_Ty> || has_deserialize_v<_Ty> || has_deserialize_constructor_v<_Ty, _Reader> ||
+            is_specialize_of_v<_Ty, std::pair> || is_specialize_of_v<_Ty, std::tuple>;
+    }
+
+    /* writers that can hand out a raw region for a fixed-size subtree, checked once */
+    template <class _Ty>
+    using has_reserve_bytes = decltype(detail::has_reserve_bytes_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_reserve_bytes_v = has_reserve_bytes<_Ty>::value;
+
+    /* readers that can hand out a raw region for a fixed-size subtree, checked once */
+    template <class _Ty>
+    using has_consume_bytes = decltype(detail::has_consume_bytes_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_consume_bytes_v = has_consume_bytes<_Ty>::value;
+
+    /* writers that can store a run of raw bytes at once */
+    template <class _Ty>
+    using has_write_bytes = decltype(detail::has_write_bytes_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_write_bytes_v = has_write_bytes<_Ty>::value;
+
+    /* writers that can patch bytes already written, e.g. a length known only after the value */
+    template <class _Ty>
+    using has_overwrite = decltype(detail::has_overwrite_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_overwrite_v = has_overwrite<_Ty>::value;
+
+    /* containers storing their elements contiguously */
+    template <class _Ty>
+    using has_data = decltype(detail::has_data_impl<_Ty>(0));
+
+    template <class _Ty>
+    constexpr bool has_data_v = has_data<_Ty>::value;
+
     template <class _Ty>
     using is_standard_container = std::conjunction<has_begin_end<_Ty>, has_iterator<_Ty>, has_size<_Ty>>;
 
@@ -329,16 +530,79 @@ namespace zeus
 
         d_aso_container,
 
-        d_custom
+        d_custom,
+
+        /* tagged fields of a custom type, see `write_record` */
+        d_record,
+
+        /* a string written before, the length is its index in the string table, see `string_table` */
+        d_string_ref,
+
+        /*
+         * sub type of a sequence of bits packed 8 per byte, lowest bit first (format 0.5), the length counts bits;
+         * d_pod is otherwise only a main type
+         */
+        d_bits = d_pod
     };
 
+    /* check if a type is a specialization of std::array */
+    template <typename _Type>
+    inline constexpr bool is_std_array_v = false;
+
+    template <typename _Type, std::size_t _Size>
+    inline constexpr bool is_std_array_v<std::array<_Type, _Size>> = true;
+
+    /*
+     * Opt-in for trivially copyable aggregates with padding: store them field by field, without the padding bytes,
+     * instead of as they are in memory. Both sides must agree, like on the definition of the type itself.
+     *
+     *   template <>
+     *   inline constexpr bool zeus::pack_fields_v<Tick> = true;
+     */
+    template <class _Ty>
+    inline constexpr bool pack_fields_v = false;
+
+    namespace detail
+    {
+        template <class _Ty>
+        constexpr bool is_raw_impl()
+        {
+            if constexpr (std::is_array_v<_Ty>)
+                return is_raw_impl<std::remove_all_extents_t<_Ty>>();
+            else if constexpr (is_std_array_v<_Ty>)
+                return is_raw_impl<typename _Ty::value_type>();
+            else
+                return std::is_trivially_copyable_v<_Ty> && !pack_fields_v<_Ty>;
+        }
+
+        /* values stored as their object representation, with one copy */
+        template <class _Ty>
+        constexpr bool is_raw_v = is_raw_impl<_Ty>();
+
+        template <class _Ty>
+        constexpr bool is_bit_vector_v = false;
+
+        template <class _Alloc>
+        constexpr bool is_bit_vector_v<std::vector<bool, _Alloc>> = true;
+
+        /* bytes taken by `count` packed bits */
+        constexpr std::size_t packed_bits_size(std::size_t count)
+        {
+            return count / 8 + (count % 8 != 0);
+        }
+    }
+
+#ifdef _MSC_VER
 #pragma warning(disable : 4702)
+#endif
     template <class _Ty>
     constexpr data_type get_data_type()
     {
         constexpr std::size_t _Size = sizeof(_Ty);
 
-        if constexpr (is_specialize_of_v<_Ty, std::pair>)
+        if constexpr (pack_fields_v<_Ty>)
+            return d_custom;
+        else if constexpr (is_specialize_of_v<_Ty, std::pair>)
             return d_pair;
         else if constexpr (is_specialize_of_v<_Ty, std::variant>)
             return d_variant;
@@ -372,7 +636,9 @@ namespace zeus
 
         return d_custom;
     }
+#ifdef _MSC_VER
 #pragma warning(default : 4702)
+#endif
 
 #pragma pack(push, 1)
     struct data_header
@@ -380,6 +646,32 @@ namespace zeus
         std::uint8_t type;
         std::uint32_t length;
 
+        /* top bit of the length of an associative container whose elements are stored in key order (format 0.3) */
+        static constexpr std::uint32_t ordered_flag = 0x80000000u;
+
+        /* clear the ordered flag off the length, tell if it was set */
+        bool take_ordered_flag()
+        {
+            bool ordered = (this->length & ordered_flag) != 0;
+
+            this->length &= ~ordered_flag;
+
+            return ordered;
+        }
+
+        /* top bit of the length of a sequence whose elements are preceded by padding (format 0.4) */
+        static constexpr std::uint32_t aligned_flag = 0x80000000u;
+
+        /* clear the aligned flag off the length, tell if it was set */
+        bool take_aligned_flag()
+        {
+            bool aligned = (this->length & aligned_flag) != 0;
+
+            this->length &= ~aligned_flag;
+
+            return aligned;
+        }
+
         void set_main_type(data_type dt)
         {
             this->type &= 0xf0;
@@ -408,13 +700,17 @@ namespace zeus
             auto subdt = get_sub_type();
             constexpr auto dt = get_data_type<_Ty>();
 
+#ifdef _MSC_VER
 #pragma warning(disable : 4127)
+#endif
 
             if (dt < d_pod && subdt < d_pod)
             {
                 return subdt >= dt;
             }
+#ifdef _MSC_VER
 #pragma warning(default : 4127)
+#endif
 
             return subdt == dt;
         }
@@ -452,12 +748,35 @@ namespace zeus
     };
 #pragma pack(pop)
 
+    namespace detail
+    {
+        /* wire size of a scalar data type, 0 if the type is not a scalar */
+        constexpr std::size_t scalar_wire_size(data_type dt)
+        {
+            switch (dt)
+            {
+            case d_byte8:
+                return 1;
+            case d_byte16:
+                return 2;
+            case d_byte32:
+            case d_float32:
+                return 4;
+            case d_byte64:
+            case d_float64:
+                return 8;
+            default:
+                return 0;
+            }
+        }
+    }
+
     struct empty_checksum
     {
         std::uint32_t operator()(const uint8_t *data, std::size_t length) const
         {
-            (void *)data;
-            (void *)length;
+            (void)data;
+            (void)length;
 
             return 0;
         }
@@ -592,863 +911,5894 @@ namespace zeus
         }
     };
 
-    // forward declaration
-    template <class _Ty, class _Writer>
-    void serialize_object(_Writer &, const _Ty &);
+    enum class error_code : std::uint8_t
+    {
+        none = 0,
 
-    template <
-        class _Ty,
-        class _Reader,
-        class>
-    _Ty deserialize_object(_Reader &);
+        version_mismatch,
+        checksum_mismatch,
 
-    class bytes_reader
-    {
-    public:
-        bytes_reader(const std::vector<std::uint8_t> &data) : m_data(std::addressof(data)) {}
+        type_mismatch,
+        length_mismatch,
+        invalid_index,
 
-        template <class _Vty>
-        _Vty read()
-        {
-            if constexpr (std::is_trivially_copyable_v<_Vty>)
-            {
-                if (!can_read<_Vty>())
-                    return _Vty{};
+        /* the value does not describe its own extent, its C++ type is needed to skip it */
+        opaque_value,
 
-                auto result = *reinterpret_cast<_Vty *>(const_cast<std::uint8_t *>(m_data->data()) + m_pos);
+        /* read beyond the end of the buffer */
+        short_buffer,
 
-                m_pos += sizeof(_Vty);
+        /* write beyond the end of the buffer */
+        overflow,
 
-                return result;
-            }
-            else
-            {
-                return deserialize_object<_Vty>(*this);
-            }
+        /* the file system failed a read or a write, see errno */
+        io_error,
+
+        /* the elements are not aligned for their type in memory, see `read_array_view` */
+        misaligned
+    };
+
+    /*
+     * Sticky error state shared by readers and writers
+     * Only the first error and the position it happened at are kept, the success path never touches it
+     */
+    class error_state
+    {
+    public:
+        error_code error() const
+        {
+            return m_error;
         }
 
-        template <class _Vty>
-        bytes_reader &operator>>(_Vty &val)
+        /*
+         * Position of the reader / writer when the first error was raised
+         */
+        std::size_t error_offset() const
         {
-            val = this->read<_Vty>();
+            return m_error_offset;
+        }
 
-            return *this;
+        bool good() const
+        {
+            return m_error == error_code::none;
         }
 
-        std::vector<std::uint8_t> read_bytes(size_t count)
+        void clear_error()
         {
-            auto available = (std::min)(count, m_data->size() - count);
+            m_error = error_code::none;
+            m_error_offset = 0;
+        }
 
-            auto result = std::vector<std::uint8_t>{m_data->data() + m_pos, m_data->data() + m_pos + available};
+    protected:
+        void record_error(error_code code, std::size_t offset)
+        {
+            if (m_error == error_code::none)
+            {
+                m_error = code;
+                m_error_offset = offset;
+            }
+        }
 
-            m_pos += available;
+    private:
+        error_code m_error{error_code::none};
+        std::size_t m_error_offset{0};
+    };
 
-            return result;
+    /*
+     * Format version a reader decodes or a writer encodes, the latest one by default
+     * `deserialize` takes it from the packer header so that data packed by an older version can still be read
+     */
+    class format_state
+    {
+    public:
+        std::uint16_t format() const
+        {
+            return m_format;
         }
 
-        template <class _Vty, std::enable_if_t<std::is_trivially_constructible_v<_Vty>, int> = 0>
-        bool can_read() const
+        void set_format(std::uint16_t version)
         {
-            return remaining() >= sizeof(_Vty);
+            m_format = version;
         }
 
-        std::size_t remaining() const
+        bool aligned() const
         {
-            return m_data->size() - m_pos;
+            return m_aligned;
         }
 
         /*
-         * Return total bytes that has been read out for now
-         * It also represent current buffer read position
+         * Writer side, pad vectors and other contiguous sequences of trivially copyable elements so that the elements
+         * start at a multiple of their alignment (up to 64 bytes) from the start of the buffer, format 0.4 and later
+         *
+         * The padding is not counted by `get_size`. Readers skip it whatever their own setting, padded sequences are
+         * read back by sequence containers but not by std::array.
          */
-        size_t count() const
+        void set_aligned(bool aligned)
         {
-            return m_pos;
+            m_aligned = aligned;
         }
 
-        void skip(std::size_t count)
+        bool sparse() const
         {
-            if (remaining() >= count)
-                m_pos += count;
+            return m_sparse;
         }
 
-        void seek(std::size_t pos)
+        /*
+         * Writer side, store vectors of integers and floating point numbers in blocks of 256 elements, each one as it
+         * is, as its non-zero elements with their indices or as runs of equal elements, whichever is the smallest,
+         * format 0.6 and later
+         *
+         * A sequence is only stored in blocks if that makes it smaller, `get_size` stays an upper bound. Readers decode
+         * the blocks whatever their own setting, into contiguous containers only (e.g. std::vector, not std::list).
+         * Padded sequences, see `set_aligned`, are never stored in blocks.
+         */
+        void set_sparse(bool sparse)
         {
-            if (pos < m_data->size() - count())
-                m_pos = pos;
+            m_sparse = sparse;
         }
 
-        void reset(const std::vector<std::uint8_t> *data)
+        bool xor_floats() const
         {
-            m_pos = 0;
-            m_data = data;
+            return m_xor_floats;
+        }
+
+        /*
+         * Writer side, store vectors of float and double in the blocks of `set_sparse` with one more layout: every
+         * element XORed with the one before it, without the leading and trailing zero bits of the XOR, which shrinks
+         * slowly changing series such as samples of a gauge, format 0.7 and later
+         *
+         * The other layouts of `set_sparse` stay available to these vectors, vectors of integers are left to
+         * `set_sparse`.
+         */
+        void set_xor_floats(bool xor_floats)
+        {
+            m_xor_floats = xor_floats;
         }
 
     private:
-        std::size_t m_pos{0};
-        const std::vector<std::uint8_t> *m_data;
+        std::uint16_t m_format{VERSION};
+        bool m_aligned{false};
+        bool m_sparse{false};
+        bool m_xor_floats{false};
     };
 
-    class bytes_reader_bounded
+    /*
+     * Strings met so far by a writer or a reader, opt-in with `set_string_table` on both sides
+     *
+     * A writer with a table writes the first occurrence of a string in full and every later one as
+     * data_header{d_string_ref, index}, a reader with a table resolves the index to the first occurrence. Readers keep
+     * views into the buffer being read, the buffer must outlive the table. Empty strings are never shared. A table
+     * spans every value written / read with it, clear it together with the buffer.
+     */
+    class string_table
     {
     public:
-        bytes_reader_bounded(const std::uint8_t *data, std::size_t length) : m_data(data), m_length(length) {}
-
-        template <class _Vty>
-        _Vty read()
+        /*
+         * Writer side, return the index of `value` if it was met before, remember it otherwise
+         */
+        std::optional<std::uint32_t> find_or_add(const std::string &value)
         {
-            if constexpr (std::is_trivially_copyable_v<_Vty>)
-            {
-                static_assert(std::is_default_constructible_v<_Vty>, "_Vty must be default constructible");
+            if (value.empty())
+                return std::nullopt;
 
-                if (!can_read<_Vty>())
-                    return _Vty{};
+            auto [it, added] = m_indices.try_emplace(value, static_cast<std::uint32_t>(m_indices.size()));
 
-                auto result = *reinterpret_cast<const _Vty *>(m_data + m_pos);
-
-                m_pos += sizeof(_Vty);
+            if (added)
+                return std::nullopt;
 
-                return result;
-            }
-            else
-            {
-                return deserialize_object<_Vty>(*this);
-            }
+            return it->second;
         }
 
-        template <class _Vty>
-        bytes_reader_bounded &operator>>(_Vty &val)
+        /*
+         * Reader side, remember the first occurrence of a string
+         */
+        void add(std::string_view value)
         {
-            val = this->read<_Vty>();
-
-            return *this;
+            if (!value.empty())
+                m_views.push_back(value);
         }
 
-        std::vector<std::uint8_t> read_bytes(size_t count)
-        {
-            auto available = (std::min)(count, m_length - count);
-
-            auto result = std::vector<std::uint8_t>{m_data + m_pos, m_data + m_pos + available};
-
-            m_pos += available;
-
-            return result;
-        }
-
-        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
-        bool can_read() const
+        /*
+         * Reader side, return nullptr if `index` does not refer to a string met before
+         */
+        const std::string_view *find(std::uint32_t index) const
         {
-            return remaining() >= sizeof(_Vty);
+            return index < m_views.size() ? std::addressof(m_views[index]) : nullptr;
         }
 
-        std::size_t remaining() const
+        std::size_t size() const
         {
-            return m_length - m_pos;
+            return m_indices.size() + m_views.size();
         }
 
-        void skip(std::size_t count)
+        void clear()
         {
-            if (remaining() >= count)
-                m_pos += count;
+            m_indices.clear();
+            m_views.clear();
         }
 
-        std::size_t count() const
-        {
-            return m_pos;
-        }
+    private:
+        std::unordered_map<std::string, std::uint32_t> m_indices;
+        std::vector<std::string_view> m_views;
+    };
 
-        void seek(std::size_t pos)
+    /*
+     * String table a reader decodes or a writer encodes with, none by default
+     */
+    class string_table_state
+    {
+    public:
+        string_table *strings() const
         {
-            if (pos < m_length - count())
-                m_pos = pos;
+            return m_strings;
         }
 
-        void reset(const std::uint8_t *data, std::size_t length)
+        void set_string_table(string_table *strings)
         {
-            m_pos = 0;
-            m_data = data;
-            m_length = length;
+            m_strings = strings;
         }
 
     private:
-        std::size_t m_pos{0};
-        const std::uint8_t *m_data{nullptr};
-        std::size_t m_length{0};
+        string_table *m_strings{nullptr};
     };
 
-    class bytes_writer
+    namespace detail
     {
-    public:
-        bytes_writer(std::vector<std::uint8_t> &data) : m_data(std::addressof(data)) {}
-
-        template <class _Vty>
-        void write(const _Vty &val)
-        {
-            if constexpr (std::is_trivially_copyable_v<_Vty>)
-            {
-                auto begin = (std::uint8_t *)std::addressof(val);
+        template <class _Ty>
+        auto has_set_error_impl(int) -> decltype(std::declval<_Ty>().set_error(error_code::none), std::true_type{});
 
-                m_data->insert(m_data->end(), begin, begin + sizeof(_Vty));
-            }
-            else
-            {
-                serialize_object(*this, val);
-            }
-        }
+        template <class _Ty>
+        std::false_type has_set_error_impl(...);
 
-        void write(const std::vector<std::uint8_t> &data)
+        /* streams that do not carry a format version use the latest one */
+        template <class _Stream>
+        constexpr bool format_since(const _Stream &stream, std::uint16_t version)
         {
-            std::copy(data.begin(), data.end(), std::back_inserter(*m_data));
+            if constexpr (std::is_base_of_v<format_state, _Stream>)
+                return stream.format() >= version;
+            else
+                return true;
         }
 
-        void write(const std::uint8_t *data, std::size_t length)
+        template <class _Stream>
+        constexpr bool compact_layout(const _Stream &stream)
         {
-            std::copy(data, data + length, std::back_inserter(*m_data));
+            return format_since(stream, VERSION_COMPACT);
         }
 
-        template <class _Vty>
-        bytes_writer &operator<<(const _Vty &val)
+        /* format version and string table, for a writer that stands in for another one */
+        template <class _From, class _To>
+        void copy_format(const _From &from, _To &to)
         {
-            this->write(val);
+            if constexpr (std::is_base_of_v<format_state, _From> && std::is_base_of_v<format_state, _To>)
+            {
+                to.set_format(from.format());
+                to.set_aligned(from.aligned());
+                to.set_sparse(from.sparse());
+                to.set_xor_floats(from.xor_floats());
+            }
 
-            return *this;
+            if constexpr (std::is_base_of_v<string_table_state, _From> && std::is_base_of_v<string_table_state, _To>)
+                to.set_string_table(from.strings());
         }
 
-        void reset(std::vector<std::uint8_t> &data)
+        template <class _Stream>
+        string_table *string_table_of(const _Stream &stream)
         {
-            m_data = std::addressof(data);
+            if constexpr (std::is_base_of_v<string_table_state, _Stream>)
+                return stream.strings();
+            else
+                return nullptr;
         }
 
-        template <class _Ty>
-        constexpr bool can_write() const
+        /* detach the string table of a stream for a scope */
+        template <class _Stream>
+        class string_table_suspension
         {
-            return true;
-        }
+        public:
+            explicit string_table_suspension(_Stream &stream) : m_stream(stream)
+            {
+                if constexpr (std::is_base_of_v<string_table_state, _Stream>)
+                {
+                    m_strings = stream.strings();
 
-        /*
-         * Get the total bytes written
-         */
-        size_t count() const
+                    stream.set_string_table(nullptr);
+                }
+            }
+
+            ~string_table_suspension()
+            {
+                if constexpr (std::is_base_of_v<string_table_state, _Stream>)
+                    m_stream.set_string_table(m_strings);
+            }
+
+            string_table_suspension(const string_table_suspension &) = delete;
+            string_table_suspension &operator=(const string_table_suspension &) = delete;
+
+        private:
+            _Stream &m_stream;
+            string_table *m_strings{nullptr};
+        };
+
+        /* readers / writers that do not carry an error state are left alone */
+        template <class _Stream>
+        void report_error(_Stream &stream, error_code code)
         {
-            return m_data->size();
+            if constexpr (decltype(has_set_error_impl<_Stream>(0))::value)
+                stream.set_error(code);
         }
+    }
 
-    private:
-        std::vector<std::uint8_t> *m_data;
-    };
-
-    class bytes_writer_bounded
+    /*
+     * Opt-in instrumentation of serialize_object / deserialize_object
+     *
+     * Define `ZPACKER_ENABLE_STATS` before including zpacker.hpp to count bytes, objects, elements, container
+     * allocations and elapsed cycles per `data_type` and per custom type. Without it the hooks expand to nothing.
+     * Counters are inclusive, the bytes of a tuple also appear under the types of its members, fixed-size subtrees
+     * are accounted as a whole.
+     */
+    namespace stats
     {
-    public:
-        bytes_writer_bounded(std::uint8_t *data, std::size_t length) : m_data(data), m_length(length) {}
+#if defined(ZPACKER_ENABLE_STATS)
+        constexpr bool enabled = true;
+#else
+        constexpr bool enabled = false;
+#endif
 
-        template <class _Vty>
-        void write(const _Vty &val)
+        struct counters
+        {
+            std::uint64_t objects_written;
+            std::uint64_t bytes_written;
+            std::uint64_t elements_written;
+            std::uint64_t cycles_written;
+
+            std::uint64_t objects_read;
+            std::uint64_t bytes_read;
+            std::uint64_t elements_read;
+            /* containers materialized with at least one element, an estimate of heap allocations */
+            std::uint64_t allocations;
+            std::uint64_t cycles_read;
+        };
+
+        struct type_counters
+        {
+            std::string name;
+            counters values;
+        };
+
+        struct snapshot
+        {
+            /* indexed by `data_type` */
+            std::array<counters, 16> data_types;
+            std::vector<type_counters> types;
+        };
+
+#if defined(ZPACKER_ENABLE_STATS)
+        namespace detail
         {
-            if constexpr (std::is_trivially_copyable_v<_Vty>)
+            struct atomic_counters
             {
-                if (can_write<_Vty>())
+                std::atomic<std::uint64_t> objects_written{0};
+                std::atomic<std::uint64_t> bytes_written{0};
+                std::atomic<std::uint64_t> elements_written{0};
+                std::atomic<std::uint64_t> cycles_written{0};
+
+                std::atomic<std::uint64_t> objects_read{0};
+                std::atomic<std::uint64_t> bytes_read{0};
+                std::atomic<std::uint64_t> elements_read{0};
+                std::atomic<std::uint64_t> allocations{0};
+                std::atomic<std::uint64_t> cycles_read{0};
+
+                counters load() const
                 {
-                    *(_Vty *)(m_data + m_pos) = val;
+                    return counters{
+                        objects_written.load(std::memory_order_relaxed),
+                        bytes_written.load(std::memory_order_relaxed),
+                        elements_written.load(std::memory_order_relaxed),
+                        cycles_written.load(std::memory_order_relaxed),
+                        objects_read.load(std::memory_order_relaxed),
+                        bytes_read.load(std::memory_order_relaxed),
+                        elements_read.load(std::memory_order_relaxed),
+                        allocations.load(std::memory_order_relaxed),
+                        cycles_read.load(std::memory_order_relaxed)};
+                }
 
-                    m_pos += sizeof(_Vty);
+                void clear()
+                {
+                    for (auto *c : {&objects_written, &bytes_written, &elements_written, &cycles_written,
+                                    &objects_read, &bytes_read, &elements_read, &allocations, &cycles_read})
+                        c->store(0, std::memory_order_relaxed);
                 }
-            }
-            else
+            };
+
+            struct registry
             {
-                serialize_object(*this, val);
-            }
-        }
+                std::array<atomic_counters, 16> data_types;
 
-        void write(const std::uint8_t *data, std::size_t length)
-        {
-            auto _copy_len = (std::min)(length, m_length - m_pos);
+                std::mutex lock;
+                std::vector<std::pair<std::string, atomic_counters *>> types;
+            };
 
-            if (_copy_len > 0)
+            inline registry &get_registry()
             {
-                memcpy(m_data + m_pos, data, _copy_len);
+                static registry instance{};
 
-                m_pos += _copy_len;
+                return instance;
             }
-        }
 
-        template <class _Vty>
-        bytes_writer_bounded &operator<<(const _Vty &val)
-        {
-            this->write(val);
+            inline std::uint64_t read_cycles()
+            {
+#if defined(_M_X64) || defined(__x86_64__)
+                return __rdtsc();
+#else
+                return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+            }
 
-            return *this;
-        }
+            template <class _Ty>
+            std::string type_name()
+            {
+#if defined(_MSC_VER)
+                std::string name = __FUNCSIG__;
+                auto begin = name.find("type_name<") + 10;
+                auto end = name.rfind(">(void)");
+#else
+                std::string name = __PRETTY_FUNCTION__;
+                auto begin = name.find("_Ty = ") + 6;
+                auto end = name.find_first_of(";]", begin);
+#endif
+                return name.substr(begin, end - begin);
+            }
 
-        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
-        bool can_write() const
-        {
-            return remaining() >= sizeof(_Vty);
-        }
+            /* counters of a custom type, registered on first use */
+            template <class _Ty>
+            atomic_counters &custom_type_counters()
+            {
+                static atomic_counters *instance = []()
+                {
+                    auto &reg = get_registry();
+                    auto counters = new atomic_counters{};
 
-        void reset(std::uint8_t *data, std::size_t length)
-        {
-            m_pos = 0;
-            m_data = data;
-            m_length = length;
-        }
+                    std::lock_guard<std::mutex> guard{reg.lock};
 
-        /*
-         * Get the total bytes written
-         */
-        std::size_t count() const
-        {
-            return m_pos;
-        }
+                    reg.types.emplace_back(type_name<_Ty>(), counters);
 
-        std::size_t remaining() const
-        {
-            return m_length - m_pos;
-        }
+                    return counters;
+                }();
 
-    private:
-        std::uint8_t *m_data{nullptr};
-        std::size_t m_pos{0};
-        std::size_t m_length{0};
-    };
+                return *instance;
+            }
 
-    template <class _Ty>
-    constexpr std::size_t get_size(const _Ty &);
+            /* stands in for `scope` where nothing has to be accounted */
+            struct null_scope
+            {
+                template <class _Stream>
+                explicit null_scope(const _Stream &) {}
+            };
+
+            /*
+             * Accounts one serialize_object / deserialize_object call from construction to destruction
+             */
+            template <class _Ty, class _Stream, bool _Write>
+            class scope
+            {
+            public:
+                explicit scope(const _Stream &stream) : m_stream(stream), m_begin(stream.count()), m_cycles(read_cycles()) {}
 
-    namespace detail
-    {
-        template <class _Variant, size_t... _Indices>
-        constexpr size_t get_variant_size_impl(const _Variant &variant, std::index_sequence<_Indices...>)
-        {
-            using _Get_variant_size_t = size_t (*)(const _Variant &);
+                ~scope()
+                {
+                    auto bytes = static_cast<std::uint64_t>(m_stream.count() - m_begin);
+                    auto cycles = read_cycles() - m_cycles;
 
-            constexpr _Get_variant_size_t _table[] =
+                    add(get_registry().data_types[get_data_type<remove_cvref_t<_Ty>>()], bytes, cycles);
+
+                    if constexpr (get_data_type<remove_cvref_t<_Ty>>() == d_custom)
+                        add(custom_type_counters<remove_cvref_t<_Ty>>(), bytes, cycles);
+                }
+
+            private:
+                static void add(atomic_counters &c, std::uint64_t bytes, std::uint64_t cycles)
                 {
-                    [](const _Variant &variant) -> size_t
+                    if constexpr (_Write)
                     {
-                        using value_type = std::variant_alternative_t<_Indices, _Variant>;
-                        return get_size<value_type>(std::get<value_type>(variant));
-                    }...};
+                        c.objects_written.fetch_add(1, std::memory_order_relaxed);
+                        c.bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+                        c.cycles_written.fetch_add(cycles, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        c.objects_read.fetch_add(1, std::memory_order_relaxed);
+                        c.bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+                        c.cycles_read.fetch_add(cycles, std::memory_order_relaxed);
+                    }
+                }
 
-            return _table[variant.index()](variant);
-        }
+                const _Stream &m_stream;
+                std::size_t m_begin;
+                std::uint64_t m_cycles;
+            };
 
-        template <class _Tuple, size_t... _Indices>
-        constexpr size_t get_tuple_size_impl(const _Tuple &tuple, std::index_sequence<_Indices...>)
-        {
-            const size_t _sizes[] = {get_size<std::tuple_element_t<_Indices, _Tuple>>(std::get<_Indices>(tuple))...};
+            template <class _Ty, bool _Write>
+            void add_elements(std::uint64_t count)
+            {
+                auto &c = get_registry().data_types[get_data_type<remove_cvref_t<_Ty>>()];
 
-            return std::accumulate(_sizes, _sizes + std::tuple_size_v<_Tuple>, (size_t)0);
-        }
+                if constexpr (_Write)
+                {
+                    c.elements_written.fetch_add(count, std::memory_order_relaxed);
+                }
+                else
+                {
+                    c.elements_read.fetch_add(count, std::memory_order_relaxed);
 
-        template <class _Tuple, class _Writer, size_t... _Indices>
-        void serialize_tuple_impl(_Writer &writer, const _Tuple &tuple, std::index_sequence<_Indices...>)
-        {
-            (writer << ... << std::get<_Indices>(tuple));
+                    if (count != 0)
+                        c.allocations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
         }
+#endif
 
-        template <class _Variant, class _Reader, size_t... _Indices>
-        _Variant deserialize_variant_impl(_Reader &reader, uint32_t index, std::index_sequence<_Indices...>)
+        /*
+         * Copy of all the counters, empty if the instrumentation is disabled
+         */
+        inline snapshot take_snapshot()
         {
-            using _Variant_deserializer_t = _Variant (*)(_Reader &);
+            snapshot result{};
 
-            constexpr _Variant_deserializer_t _table[] =
-                {
-                    [](_Reader &reader) -> _Variant
-                    {
-                        using value_type = std::variant_alternative_t<_Indices, _Variant>;
+#if defined(ZPACKER_ENABLE_STATS)
+            auto &reg = detail::get_registry();
 
-                        return _Variant{reader.template read<value_type>()};
-                    }...};
+            for (std::size_t i = 0; i < reg.data_types.size(); ++i)
+                result.data_types[i] = reg.data_types[i].load();
+
+            std::lock_guard<std::mutex> guard{reg.lock};
+
+            for (auto &entry : reg.types)
+                result.types.push_back(type_counters{entry.first, entry.second->load()});
+#endif
 
-            return _table[index](reader);
+            return result;
         }
 
-        template <class _Tuple, class _Reader, size_t... _Indices>
-        _Tuple deserialize_tuple_impl(_Reader &reader, std::index_sequence<_Indices...>)
+        inline void reset()
         {
-            _Tuple __t{};
+#if defined(ZPACKER_ENABLE_STATS)
+            auto &reg = detail::get_registry();
 
-            (reader >> ... >> std::get<_Indices>(__t));
+            for (auto &c : reg.data_types)
+                c.clear();
 
-            return __t;
+            std::lock_guard<std::mutex> guard{reg.lock};
+
+            for (auto &entry : reg.types)
+                entry.second->clear();
+#endif
         }
     }
 
-    template <class _Ty>
-    constexpr void get_object_size(const _Ty &object, std::size_t &size)
-    {
-        constexpr std::size_t header_size = sizeof(data_header);
+#if defined(ZPACKER_ENABLE_STATS)
+/* fixed-size subtrees are accounted by the outer call only */
+#define _ZPACKER_STATS_SCOPE(__type, __stream, __write)                                                                        \
+    std::conditional_t<std::is_same_v<std::remove_cv_t<std::remove_reference_t<decltype(__stream)>>, bytes_writer_unchecked> || \
+                           std::is_same_v<std::remove_cv_t<std::remove_reference_t<decltype(__stream)>>, bytes_reader_unchecked>, \
+                       stats::detail::null_scope,                                                                              \
+                       stats::detail::scope<__type, std::remove_reference_t<decltype(__stream)>, __write>>                     \
+        _stats_scope { __stream }
+#define _ZPACKER_STATS_ELEMENTS(__type, __count, __write) stats::detail::add_elements<__type, __write>(__count)
+#else
+#define _ZPACKER_STATS_SCOPE(__type, __stream, __write)
+#define _ZPACKER_STATS_ELEMENTS(__type, __count, __write)
+#endif
 
-        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be serialized can not be pointer type");
+    // forward declaration
+    template <class _Ty, class _Writer>
+    void serialize_object(_Writer &, const _Ty &);
 
-        if constexpr (has_get_size_v<_Ty>)
-        {
-            size += object.get_size();
-        }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::pair>)
-        {
-            size += sizeof(data_header);
+    template <
+        class _Ty,
+        class _Reader,
+        class>
+    _Ty deserialize_object(_Reader &);
 
-            get_object_size(object.first, size);
-            get_object_size(object.second, size);
-        }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::variant>)
-        {
-            using _Variant = remove_cvref_t<_Ty>;
+    template <class _Ty, class _Reader>
+    void deserialize_object_into(_Reader &, _Ty &);
 
-            size += sizeof(data_header);
+    namespace detail
+    {
+        /* `reader >> value`, C arrays, containers, pairs and tuples are read in place */
+        template <class _Reader, class _Ty>
+        void read_into(_Reader &reader, _Ty &value);
+    }
 
-            size += detail::get_variant_size_impl(object, std::make_index_sequence<std::variant_size_v<_Variant>>{});
-        }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::tuple>)
+    class bytes_reader : public error_state, public format_state, public string_table_state
+    {
+    public:
+        bytes_reader(const std::vector<std::uint8_t> &data) : m_data(std::addressof(data)) {}
+
+        template <class _Vty>
+        _Vty read()
         {
-            using _Tuple = remove_cvref_t<_Ty>;
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                if (!can_read<_Vty>())
+                {
+                    set_error(error_code::short_buffer);
+                    return _Vty{};
+                }
 
-            size += sizeof(data_header);
+                _Vty result;
 
-            size += detail::get_tuple_size_impl(object, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
-        }
-        else if constexpr (is_standard_container_v<remove_cvref_t<_Ty>>)
-        {
-            using value_type = typename remove_cvref_t<_Ty>::value_type;
+                memcpy(std::addressof(result), m_data->data() + m_pos, sizeof(_Vty));
 
-            size += header_size;
+                m_pos += sizeof(_Vty);
+
+                return result;
+            }
+            else
+            {
+                return deserialize_object<_Vty>(*this);
+            }
+        }
+
+        template <class _Vty>
+        bytes_reader &operator>>(_Vty &val)
+        {
+            detail::read_into(*this, val);
+
+            return *this;
+        }
+
+        std::vector<std::uint8_t> read_bytes(size_t count)
+        {
+            auto available = (std::min)(count, remaining());
+
+            if (available < count)
+                set_error(error_code::short_buffer);
+
+            auto result = std::vector<std::uint8_t>{m_data->data() + m_pos, m_data->data() + m_pos + available};
+
+            m_pos += available;
+
+            return result;
+        }
+
+        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
+        bool can_read() const
+        {
+            return remaining() >= sizeof(_Vty);
+        }
+
+        /*
+         * Check the bounds once for `length` bytes and return them for unchecked loads
+         * Return nullptr if there is not enough data left
+         */
+        const std::uint8_t *consume_bytes(std::size_t length)
+        {
+            if (remaining() < length)
+            {
+                set_error(error_code::short_buffer);
+                return nullptr;
+            }
+
+            auto result = m_data->data() + m_pos;
+
+            m_pos += length;
+
+            return result;
+        }
+
+        std::size_t remaining() const
+        {
+            return m_data->size() - m_pos;
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_pos);
+        }
+
+        /*
+         * Return total bytes that has been read out for now
+         * It also represent current buffer read position
+         */
+        size_t count() const
+        {
+            return m_pos;
+        }
+
+        void skip(std::size_t count)
+        {
+            if (remaining() >= count)
+                m_pos += count;
+            else
+                set_error(error_code::short_buffer);
+        }
+
+        void seek(std::size_t pos)
+        {
+            if (pos < m_data->size() - count())
+                m_pos = pos;
+        }
+
+        void reset(const std::vector<std::uint8_t> *data)
+        {
+            m_pos = 0;
+            m_data = data;
+            clear_error();
+        }
+
+    private:
+        std::size_t m_pos{0};
+        const std::vector<std::uint8_t> *m_data;
+    };
+
+    class bytes_reader_bounded : public error_state, public format_state, public string_table_state
+    {
+    public:
+        bytes_reader_bounded(const std::uint8_t *data, std::size_t length) : m_data(data), m_length(length) {}
+
+        template <class _Vty>
+        _Vty read()
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                static_assert(std::is_default_constructible_v<_Vty>, "_Vty must be default constructible");
+
+                if (!can_read<_Vty>())
+                {
+                    set_error(error_code::short_buffer);
+                    return _Vty{};
+                }
+
+                _Vty result;
+
+                memcpy(std::addressof(result), m_data + m_pos, sizeof(_Vty));
+
+                m_pos += sizeof(_Vty);
+
+                return result;
+            }
+            else
+            {
+                return deserialize_object<_Vty>(*this);
+            }
+        }
+
+        template <class _Vty>
+        bytes_reader_bounded &operator>>(_Vty &val)
+        {
+            detail::read_into(*this, val);
+
+            return *this;
+        }
+
+        std::vector<std::uint8_t> read_bytes(size_t count)
+        {
+            auto available = (std::min)(count, remaining());
+
+            if (available < count)
+                set_error(error_code::short_buffer);
+
+            auto result = std::vector<std::uint8_t>{m_data + m_pos, m_data + m_pos + available};
+
+            m_pos += available;
+
+            return result;
+        }
+
+        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
+        bool can_read() const
+        {
+            return remaining() >= sizeof(_Vty);
+        }
+
+        /*
+         * Check the bounds once for `length` bytes and return them for unchecked loads
+         * Return nullptr if there is not enough data left
+         */
+        const std::uint8_t *consume_bytes(std::size_t length)
+        {
+            if (remaining() < length)
+            {
+                set_error(error_code::short_buffer);
+                return nullptr;
+            }
+
+            auto result = m_data + m_pos;
+
+            m_pos += length;
+
+            return result;
+        }
+
+        std::size_t remaining() const
+        {
+            return m_length - m_pos;
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_pos);
+        }
+
+        void skip(std::size_t count)
+        {
+            if (remaining() >= count)
+                m_pos += count;
+            else
+                set_error(error_code::short_buffer);
+        }
+
+        std::size_t count() const
+        {
+            return m_pos;
+        }
+
+        void seek(std::size_t pos)
+        {
+            if (pos < m_length - count())
+                m_pos = pos;
+        }
+
+        void reset(const std::uint8_t *data, std::size_t length)
+        {
+            m_pos = 0;
+            m_data = data;
+            m_length = length;
+            clear_error();
+        }
+
+    private:
+        std::size_t m_pos{0};
+        const std::uint8_t *m_data{nullptr};
+        std::size_t m_length{0};
+    };
+
+    class bytes_writer_bounded : public error_state, public format_state, public string_table_state
+    {
+    public:
+        bytes_writer_bounded(std::uint8_t *data, std::size_t length) : m_data(data), m_length(length) {}
+
+        template <class _Vty>
+        void write(const _Vty &val)
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                if (!can_write<_Vty>())
+                {
+                    set_error(error_code::overflow);
+                    return;
+                }
+
+                memcpy(m_data + m_pos, std::addressof(val), sizeof(_Vty));
+
+                m_pos += sizeof(_Vty);
+            }
+            else
+            {
+                serialize_object(*this, val);
+            }
+        }
+
+        void write(const std::uint8_t *data, std::size_t length)
+        {
+            if (auto _dest = reserve_bytes(length))
+                memcpy(_dest, data, length);
+        }
+
+        template <class _Vty>
+        bytes_writer_bounded &operator<<(const _Vty &val)
+        {
+            this->write(val);
+
+            return *this;
+        }
+
+        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
+        bool can_write() const
+        {
+            return remaining() >= sizeof(_Vty);
+        }
+
+        /*
+         * Check the capacity once for `length` bytes and return them for unchecked stores
+         * Return nullptr and nothing is written if they do not fit
+         */
+        std::uint8_t *reserve_bytes(std::size_t length)
+        {
+            if (remaining() < length)
+            {
+                set_error(error_code::overflow);
+                return nullptr;
+            }
+
+            auto result = m_data + m_pos;
+
+            m_pos += length;
+
+            return result;
+        }
+
+        /*
+         * Replace `length` bytes already written at `pos`
+         */
+        void overwrite(std::size_t pos, const void *data, std::size_t length)
+        {
+            if (pos + length <= m_pos)
+                memcpy(m_data + pos, data, length);
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_pos);
+        }
+
+        void reset(std::uint8_t *data, std::size_t length)
+        {
+            m_pos = 0;
+            m_data = data;
+            m_length = length;
+            clear_error();
+        }
+
+        /*
+         * Get the total bytes written
+         */
+        std::size_t count() const
+        {
+            return m_pos;
+        }
+
+        std::size_t remaining() const
+        {
+            return m_length - m_pos;
+        }
+
+    private:
+        std::uint8_t *m_data{nullptr};
+        std::size_t m_pos{0};
+        std::size_t m_length{0};
+    };
+
+    /*
+     * Byte buffer holding up to `_Size` bytes inline, it moves to the heap once they are exceeded
+     *
+     * Bytes added by `resize` are left uninitialized. Moving a buffer that is still inline copies its bytes.
+     */
+    template <std::size_t _Size>
+    class small_buffer
+    {
+        static_assert(_Size > 0, "small_buffer needs some inline storage");
+
+    public:
+        small_buffer() = default;
+
+        small_buffer(const small_buffer &other)
+        {
+            assign(other.data(), other.size());
+        }
+
+        small_buffer(small_buffer &&other) noexcept
+        {
+            take(other);
+        }
+
+        small_buffer &operator=(const small_buffer &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                assign(other.data(), other.size());
+            }
+
+            return *this;
+        }
+
+        small_buffer &operator=(small_buffer &&other) noexcept
+        {
+            if (this != &other)
+                take(other);
+
+            return *this;
+        }
+
+        std::uint8_t *data()
+        {
+            return m_data;
+        }
+
+        const std::uint8_t *data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        std::size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        /* whether the bytes outgrew the inline storage */
+        bool on_heap() const
+        {
+            return m_data != m_inline;
+        }
+
+        std::uint8_t *begin()
+        {
+            return m_data;
+        }
+
+        std::uint8_t *end()
+        {
+            return m_data + m_size;
+        }
+
+        const std::uint8_t *begin() const
+        {
+            return m_data;
+        }
+
+        const std::uint8_t *end() const
+        {
+            return m_data + m_size;
+        }
+
+        /* the heap storage, if any, is kept for the next bytes */
+        void clear()
+        {
+            m_size = 0;
+        }
+
+        /* grow the storage to at least `capacity` bytes, at least doubling it */
+        void reserve(std::size_t capacity)
+        {
+            if (capacity <= m_capacity)
+                return;
+
+            capacity = (std::max)(capacity, 2 * m_capacity);
+
+            auto _heap = std::unique_ptr<std::uint8_t[]>(new std::uint8_t[capacity]);
+
+            if (m_size != 0)
+                memcpy(_heap.get(), m_data, m_size);
+
+            m_heap = std::move(_heap);
+            m_data = m_heap.get();
+            m_capacity = capacity;
+        }
+
+        void resize(std::size_t size)
+        {
+            reserve(size);
+
+            m_size = size;
+        }
+
+    private:
+        void assign(const std::uint8_t *data, std::size_t size)
+        {
+            resize(size);
+
+            if (size != 0)
+                memcpy(m_data, data, size);
+        }
+
+        void take(small_buffer &other)
+        {
+            if (other.on_heap())
+            {
+                m_heap = std::move(other.m_heap);
+                m_data = m_heap.get();
+                m_size = other.m_size;
+                m_capacity = other.m_capacity;
+
+                other.m_data = other.m_inline;
+                other.m_capacity = _Size;
+            }
+            else
+            {
+                clear();
+                assign(other.data(), other.size());
+            }
+
+            other.m_size = 0;
+        }
+
+        std::unique_ptr<std::uint8_t[]> m_heap;
+        std::uint8_t *m_data{m_inline};
+        std::size_t m_size{0};
+        std::size_t m_capacity{_Size};
+        std::uint8_t m_inline[_Size];
+    };
+
+    /*
+     * Byte buffer over memory owned by the caller, e.g. a shared memory segment or the send buffer of a connection
+     *
+     * `grow(data, size, needed)` is called when `needed` bytes do not fit, it returns the region to go on in, holding
+     * the `size` bytes written so far, with its capacity: `std::pair<std::uint8_t *, std::size_t>`. A capacity below
+     * `needed` leaves the buffer as it is, writers report an overflow. Asking for more than `needed` amortizes the
+     * calls.
+     */
+    template <class _Grow>
+    class callback_buffer
+    {
+    public:
+        callback_buffer(std::uint8_t *data, std::size_t capacity, _Grow grow)
+            : m_data(data), m_capacity(capacity), m_grow(std::move(grow)) {}
+
+        std::uint8_t *data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        std::size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        void clear()
+        {
+            m_size = 0;
+        }
+
+        void resize(std::size_t size)
+        {
+            if (size > m_capacity)
+            {
+                auto [_data, _capacity] = m_grow(m_data, m_size, size);
+
+                m_data = _data;
+                m_capacity = _capacity;
+
+                if (size > m_capacity)
+                    return;
+            }
+
+            m_size = size;
+        }
+
+    private:
+        std::uint8_t *m_data;
+        std::size_t m_size{0};
+        std::size_t m_capacity;
+        _Grow m_grow;
+    };
+
+    namespace detail
+    {
+        template <class _Ty>
+        auto has_reserve_capacity_impl(int) -> decltype(std::declval<_Ty>().reserve(std::size_t{}), std::declval<_Ty>().capacity(), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_reserve_capacity_impl(...);
+
+        template <class _Ty>
+        constexpr bool has_reserve_capacity_v = decltype(has_reserve_capacity_impl<_Ty>(0))::value;
+
+        template <class _Ty>
+        auto has_byte_append_impl(int) -> decltype(std::declval<_Ty>().append(std::declval<const typename _Ty::value_type *>(), std::size_t{}), std::true_type{});
+
+        template <class _Ty>
+        std::false_type has_byte_append_impl(...);
+
+        /* strings of bytes, e.g. std::string */
+        template <class _Ty>
+        constexpr bool has_byte_append_v = decltype(has_byte_append_impl<_Ty>(0))::value;
+
+        template <class _Ty>
+        auto has_byte_insert_impl(int) -> decltype(std::declval<_Ty>().insert(std::declval<_Ty>().end(), std::declval<const std::uint8_t *>(), std::declval<const std::uint8_t *>()),
+                                                   std::enable_if_t<std::is_same_v<typename _Ty::value_type, std::uint8_t>, std::true_type>{});
+
+        template <class _Ty>
+        std::false_type has_byte_insert_impl(...);
+
+        /* vectors of std::uint8_t, they append a range of bytes at their end */
+        template <class _Ty>
+        constexpr bool has_byte_insert_v = decltype(has_byte_insert_impl<_Ty>(0))::value;
+
+        /* grow a buffer to `size` bytes, at least doubling the storage of buffers that tell their capacity */
+        template <class _Buffer>
+        void grow_buffer(_Buffer &buffer, std::size_t size)
+        {
+            if constexpr (has_reserve_capacity_v<_Buffer>)
+            {
+                if (size > buffer.capacity())
+                    buffer.reserve((std::max)(size, 2 * static_cast<std::size_t>(buffer.capacity())));
+            }
+
+            buffer.resize(size);
+        }
+    }
+
+    /*
+     * Writer appending to a contiguous byte buffer: anything with data(), size() and resize() over 1-byte elements,
+     * e.g. std::vector<std::uint8_t>, std::string, std::pmr::vector<std::byte>, `small_buffer` or `callback_buffer`
+     *
+     * The bytes land in the buffer itself: it is grown once per value, by at least doubling its storage, and the value
+     * is stored through a pointer into it. Except for std::string and vectors of std::uint8_t, which append each value
+     * with `append` / `insert` rather than zeroing it first by `resize`; fixed-size subtrees still go through
+     * `reserve_bytes` for them. A buffer that cannot grow reports an overflow.
+     */
+    template <class _Buffer>
+    class basic_bytes_writer : public error_state, public format_state, public string_table_state
+    {
+        static_assert(sizeof(*std::declval<_Buffer &>().data()) == 1, "the buffer must hold bytes");
+
+    public:
+        basic_bytes_writer(_Buffer &data) : m_data(std::addressof(data)) {}
+
+        template <class _Vty>
+        void write(const _Vty &val)
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+                write(reinterpret_cast<const std::uint8_t *>(std::addressof(val)), sizeof(_Vty));
+            else
+                serialize_object(*this, val);
+        }
+
+        void write(const std::vector<std::uint8_t> &data)
+        {
+            write(data.data(), data.size());
+        }
+
+        void write(const std::uint8_t *data, std::size_t length)
+        {
+            if (length == 0)
+                return;
+
+            /* cheaper than growing standard containers by `resize`, which zeroes the new bytes first */
+            if constexpr (detail::has_byte_append_v<_Buffer>)
+            {
+                m_data->append(reinterpret_cast<const typename _Buffer::value_type *>(data), length);
+            }
+            else if constexpr (detail::has_byte_insert_v<_Buffer>)
+            {
+                m_data->insert(m_data->end(), data, data + length);
+            }
+            else
+            {
+                if (auto _dest = reserve_bytes(length))
+                    memcpy(_dest, data, length);
+            }
+        }
+
+        template <class _Vty>
+        basic_bytes_writer &operator<<(const _Vty &val)
+        {
+            this->write(val);
+
+            return *this;
+        }
+
+        /*
+         * Grow the buffer once by `length` bytes and return them for unchecked stores
+         * Return nullptr and nothing is written if the buffer cannot grow
+         */
+        std::uint8_t *reserve_bytes(std::size_t length)
+        {
+            const auto _pos = static_cast<std::size_t>(m_data->size());
+
+            detail::grow_buffer(*m_data, _pos + length);
+
+            if (m_data->size() < _pos + length)
+            {
+                set_error(error_code::overflow);
+                return nullptr;
+            }
+
+            return reinterpret_cast<std::uint8_t *>(m_data->data()) + _pos;
+        }
+
+        /*
+         * Replace `length` bytes already written at `pos`
+         */
+        void overwrite(std::size_t pos, const void *data, std::size_t length)
+        {
+            if (pos + length <= m_data->size())
+                memcpy(reinterpret_cast<std::uint8_t *>(m_data->data()) + pos, data, length);
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_data->size());
+        }
+
+        void reset(_Buffer &data)
+        {
+            m_data = std::addressof(data);
+
+            clear_error();
+        }
+
+        template <class _Ty>
+        constexpr bool can_write() const
+        {
+            return true;
+        }
+
+        /*
+         * Get the total bytes written
+         */
+        std::size_t count() const
+        {
+            return m_data->size();
+        }
+
+    private:
+        _Buffer *m_data;
+    };
+
+    /*
+     * Writer appending to a `small_buffer`, small messages are serialized without touching the heap
+     */
+    template <std::size_t _Size>
+    using small_bytes_writer = basic_bytes_writer<small_buffer<_Size>>;
+
+    /*
+     * Writer over a region whose capacity has already been checked for a whole fixed-size subtree
+     */
+    class bytes_writer_unchecked
+    {
+    public:
+        explicit bytes_writer_unchecked(std::uint8_t *data) : m_data(data) {}
+
+        template <class _Vty>
+        void write(const _Vty &val)
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                memcpy(m_data + m_pos, std::addressof(val), sizeof(_Vty));
+
+                m_pos += sizeof(_Vty);
+            }
+            else
+            {
+                serialize_object(*this, val);
+            }
+        }
+
+        void write(const std::uint8_t *data, std::size_t length)
+        {
+            memcpy(m_data + m_pos, data, length);
+
+            m_pos += length;
+        }
+
+        template <class _Vty>
+        bytes_writer_unchecked &operator<<(const _Vty &val)
+        {
+            this->write(val);
+
+            return *this;
+        }
+
+        template <class _Ty>
+        constexpr bool can_write() const
+        {
+            return true;
+        }
+
+        std::size_t count() const
+        {
+            return m_pos;
+        }
+
+    private:
+        std::uint8_t *m_data;
+        std::size_t m_pos{0};
+    };
+
+    /*
+     * Reader over a region whose bounds have already been checked for a whole fixed-size subtree
+     */
+    class bytes_reader_unchecked : public error_state
+    {
+    public:
+        bytes_reader_unchecked(const std::uint8_t *data, std::size_t length) : m_data(data), m_length(length) {}
+
+        template <class _Vty>
+        _Vty read()
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                _Vty result;
+
+                memcpy(std::addressof(result), m_data + m_pos, sizeof(_Vty));
+
+                m_pos += sizeof(_Vty);
+
+                return result;
+            }
+            else
+            {
+                return deserialize_object<_Vty>(*this);
+            }
+        }
+
+        template <class _Vty>
+        bytes_reader_unchecked &operator>>(_Vty &val)
+        {
+            detail::read_into(*this, val);
+
+            return *this;
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_pos);
+        }
+
+        template <class _Vty>
+        constexpr bool can_read() const
+        {
+            return true;
+        }
+
+        /*
+         * Hand out `length` bytes, the bounds of the whole region have been checked already
+         */
+        const std::uint8_t *consume_bytes(std::size_t length)
+        {
+            auto result = m_data + m_pos;
+
+            m_pos += length;
+
+            return result;
+        }
+
+        std::size_t remaining() const
+        {
+            return m_length - m_pos;
+        }
+
+        std::size_t count() const
+        {
+            return m_pos;
+        }
+
+    private:
+        const std::uint8_t *m_data;
+        std::size_t m_length;
+        std::size_t m_pos{0};
+    };
+
+    template <class _Ty>
+    constexpr std::size_t get_size(const _Ty &);
+
+    namespace detail
+    {
+        /* converts to any field type, probes how many initializers an aggregate takes */
+        struct any_field
+        {
+            template <class _Ty>
+            operator _Ty() const;
+        };
+
+        template <class _Ty, std::size_t... _Indices>
+        auto is_initializable_impl(std::index_sequence<_Indices...>) -> decltype(_Ty{(void(_Indices), any_field{})...}, std::true_type{});
+
+        template <class _Ty>
+        std::false_type is_initializable_impl(...);
+
+        constexpr std::size_t max_field_count = 16;
+
+        /* number of fields of an aggregate, 0 if it has more than `max_field_count` */
+        template <class _Ty, std::size_t _Count = max_field_count + 1>
+        constexpr std::size_t field_count()
+        {
+            if constexpr (_Count == 0)
+                return 0;
+            else if constexpr (decltype(is_initializable_impl<_Ty>(std::make_index_sequence<_Count>{}))::value)
+                return _Count > max_field_count ? 0 : _Count;
+            else
+                return field_count<_Ty, _Count - 1>();
+        }
+
+        template <class _Ty>
+        constexpr bool is_reflectable_impl()
+        {
+            if constexpr (!std::is_class_v<_Ty> || !std::is_aggregate_v<_Ty> || is_std_array_v<_Ty> ||
+                          has_serialize_v<_Ty> || has_deserialize_v<_Ty> || has_get_size_v<_Ty> || has_iterator_v<_Ty>)
+                return false;
+            else if constexpr (std::is_trivially_copyable_v<_Ty> && !pack_fields_v<_Ty>)
+                return false;
+            else
+                return field_count<_Ty>() != 0;
+        }
+
+        /*
+         * Aggregates without serialization methods are written field after field, in declaration order and without a
+         * header, like a custom type whose `serialize` writes every field. Trivially copyable ones only with
+         * `pack_fields_v`, they are stored as they are otherwise. Fields are enumerated by structured bindings: no
+         * base classes, no C arrays (use std::array), no bit-fields, at most `max_field_count` fields.
+         */
+        template <class _Ty>
+        constexpr bool is_reflectable_v = is_reflectable_impl<_Ty>();
+
+        /* references to the fields of an aggregate, as a tuple */
+        template <class _Ty>
+        auto tie_fields(_Ty &object)
+        {
+            constexpr auto _Count = field_count<std::remove_const_t<_Ty>>();
+
+            if constexpr (_Count == 1)
+            {
+                auto &[f0] = object;
+
+                return std::tie(f0);
+            }
+            else if constexpr (_Count == 2)
+            {
+                auto &[f0, f1] = object;
+
+                return std::tie(f0, f1);
+            }
+            else if constexpr (_Count == 3)
+            {
+                auto &[f0, f1, f2] = object;
+
+                return std::tie(f0, f1, f2);
+            }
+            else if constexpr (_Count == 4)
+            {
+                auto &[f0, f1, f2, f3] = object;
+
+                return std::tie(f0, f1, f2, f3);
+            }
+            else if constexpr (_Count == 5)
+            {
+                auto &[f0, f1, f2, f3, f4] = object;
+
+                return std::tie(f0, f1, f2, f3, f4);
+            }
+            else if constexpr (_Count == 6)
+            {
+                auto &[f0, f1, f2, f3, f4, f5] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5);
+            }
+            else if constexpr (_Count == 7)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6);
+            }
+            else if constexpr (_Count == 8)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+            }
+            else if constexpr (_Count == 9)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+            }
+            else if constexpr (_Count == 10)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+            }
+            else if constexpr (_Count == 11)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+            }
+            else if constexpr (_Count == 12)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+            }
+            else if constexpr (_Count == 13)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+            }
+            else if constexpr (_Count == 14)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+            }
+            else if constexpr (_Count == 15)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+            }
+            else if constexpr (_Count == 16)
+            {
+                auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = object;
+
+                return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+            }
+            else
+                static_assert(Always_false<_Ty>, "_Ty has too many fields to be enumerated");
+        }
+
+        template <class _Tuple>
+        struct remove_cvref_elements;
+
+        template <class... _Types>
+        struct remove_cvref_elements<std::tuple<_Types...>>
+        {
+            using type = std::tuple<remove_cvref_t<_Types>...>;
+        };
+
+        /* types of the fields of an aggregate, as a tuple */
+        template <class _Ty>
+        using field_types_t = typename remove_cvref_elements<decltype(tie_fields(std::declval<_Ty &>()))>::type;
+
+        template <class _Writer, class _Ty>
+        void write_fields(_Writer &writer, const _Ty &object)
+        {
+            std::apply([&writer](const auto &...fields)
+                       { (writer << ... << fields); },
+                       tie_fields(object));
+        }
+
+        template <class _Reader, class _Ty>
+        void read_fields(_Reader &reader, _Ty &object)
+        {
+            std::apply([&reader](auto &...fields)
+                       { (read_into(reader, fields), ...); },
+                       tie_fields(object));
+        }
+    }
+
+    /* the serialized size of the type depends on the value, see `static_wire_size_v` */
+    constexpr std::size_t dynamic_wire_size = (std::numeric_limits<std::size_t>::max)();
+
+    namespace detail
+    {
+        template <class _Ty>
+        constexpr std::size_t static_wire_size_impl();
+
+        /* index of a variant in the compact layout */
+        template <class _Variant>
+        using variant_index_t = std::conditional_t<(std::variant_size_v<_Variant> < 256), std::uint8_t, std::uint32_t>;
+
+        constexpr std::size_t add_wire_size(std::size_t lhs, std::size_t rhs)
+        {
+            return (lhs == dynamic_wire_size || rhs == dynamic_wire_size) ? dynamic_wire_size : lhs + rhs;
+        }
+
+        /* size of `_Ty` when it is nested in another object, i.e. written by `writer << value` */
+        template <class _Ty>
+        constexpr std::size_t static_nested_size_impl()
+        {
+            if constexpr (is_raw_v<_Ty>)
+                return sizeof(_Ty);
+            else
+                return static_wire_size_impl<_Ty>();
+        }
+
+        template <class _Tuple, size_t... _Indices>
+        constexpr std::size_t static_tuple_size_impl(std::index_sequence<_Indices...>)
+        {
+            std::size_t size = 0;
+
+            ((size = add_wire_size(size, static_nested_size_impl<std::tuple_element_t<_Indices, _Tuple>>())), ...);
+
+            return size;
+        }
+
+        /* a variant has a static size only if all of its alternatives have the same static size */
+        template <class _Variant, size_t... _Indices>
+        constexpr std::size_t static_variant_size_impl(std::index_sequence<_Indices...>)
+        {
+            constexpr std::size_t _sizes[] = {static_nested_size_impl<std::variant_alternative_t<_Indices, _Variant>>()...};
+
+            for (auto size : _sizes)
+            {
+                if (size != _sizes[0])
+                    return dynamic_wire_size;
+            }
+
+            return _sizes[0];
+        }
+
+        template <class _Ty>
+        constexpr std::size_t static_wire_size_impl()
+        {
+            constexpr std::size_t header_size = sizeof(data_header);
+
+            if constexpr (std::is_pointer_v<_Ty> || has_serialize_v<_Ty> || has_deserialize_v<_Ty> || has_get_size_v<_Ty>)
+            {
+                return dynamic_wire_size;
+            }
+            else if constexpr (is_specialize_of_v<_Ty, std::pair>)
+            {
+                return add_wire_size(header_size, add_wire_size(static_nested_size_impl<typename _Ty::first_type>(),
+                                                                static_nested_size_impl<typename _Ty::second_type>()));
+            }
+            else if constexpr (is_specialize_of_v<_Ty, std::variant>)
+            {
+                return add_wire_size(sizeof(variant_index_t<_Ty>),
+                                     static_variant_size_impl<_Ty>(std::make_index_sequence<std::variant_size_v<_Ty>>{}));
+            }
+            else if constexpr (is_specialize_of_v<_Ty, std::tuple>)
+            {
+                return static_tuple_size_impl<_Ty>(std::make_index_sequence<std::tuple_size_v<_Ty>>{});
+            }
+            else if constexpr (is_std_array_v<_Ty>)
+            {
+                constexpr std::size_t element_size = static_nested_size_impl<typename _Ty::value_type>();
+
+                if constexpr (element_size == dynamic_wire_size)
+                    return dynamic_wire_size;
+                else
+                    return header_size + element_size * std::tuple_size_v<_Ty>;
+            }
+            else if constexpr (is_standard_container_v<_Ty> || has_iterator_v<_Ty>)
+            {
+                return dynamic_wire_size;
+            }
+            else if constexpr (is_reflectable_v<_Ty>)
+            {
+                using _Fields = field_types_t<_Ty>;
+
+                return static_tuple_size_impl<_Fields>(std::make_index_sequence<std::tuple_size_v<_Fields>>{});
+            }
+            else if constexpr (is_raw_v<_Ty>)
+            {
+                if constexpr (std::is_compound_v<_Ty>)
+                    return header_size + sizeof(_Ty);
+                else
+                    return sizeof(_Ty);
+            }
+            else
+            {
+                return dynamic_wire_size;
+            }
+        }
+    }
+
+    /*
+     * Exact serialized size of `_Ty` in the latest format computed at compile time, or `dynamic_wire_size` if it
+     * depends on the value
+     * e.g. std::tuple<int, double>, std::pair<uint32_t, float>, std::array<int, 4> and nested combinations of them
+     */
+    template <class _Ty>
+    inline constexpr std::size_t static_wire_size_v = detail::static_wire_size_impl<remove_cvref_t<_Ty>>();
+
+    template <class _Ty>
+    inline constexpr bool is_fixed_wire_size_v = static_wire_size_v<_Ty> != dynamic_wire_size;
+
+    namespace detail
+    {
+        /* lower bound of the size of `_Ty` nested in a container */
+        template <class _Ty>
+        constexpr std::size_t min_nested_size()
+        {
+            constexpr std::size_t size = static_nested_size_impl<remove_cvref_t<_Ty>>();
+
+            return (size == dynamic_wire_size || size == 0) ? 1 : size;
+        }
+
+        /* memory reserved up front for elements whose wire size is not known, a forged length costs no more */
+        constexpr std::size_t max_reserve_bytes = 1024 * 1024;
+
+        /*
+         * Elements to reserve for a decoded length already checked against `min_nested_size`: all of them when their
+         * wire size is known, the buffer holds them then. Elements of dynamic size may take 1 byte on the wire for each
+         * `sizeof(_Ty)` bytes reserved, the container grows as they are decoded past `max_reserve_bytes`.
+         */
+        template <class _Ty>
+        constexpr std::size_t reserve_count(std::size_t length)
+        {
+            constexpr std::size_t size = static_nested_size_impl<remove_cvref_t<_Ty>>();
+
+            if constexpr (size != dynamic_wire_size && size != 0)
+                return length;
+            else
+                return (std::min)(length, (std::max)(max_reserve_bytes / sizeof(_Ty), std::size_t{1}));
+        }
+    }
+
+    namespace detail
+    {
+        template <class _Variant, size_t... _Indices>
+        constexpr size_t get_variant_size_impl(const _Variant &variant, std::index_sequence<_Indices...>)
+        {
+            using _Get_variant_size_t = size_t (*)(const _Variant &);
+
+            constexpr _Get_variant_size_t _table[] =
+                {
+                    [](const _Variant &variant) -> size_t
+                    {
+                        using value_type = std::variant_alternative_t<_Indices, _Variant>;
+                        return get_size<value_type>(std::get<_Indices>(variant));
+                    }...};
+
+            return _table[variant.index()](variant);
+        }
+
+        template <class _Tuple, size_t... _Indices>
+        constexpr size_t get_tuple_size_impl(const _Tuple &tuple, std::index_sequence<_Indices...>)
+        {
+            const size_t _sizes[] = {get_size<std::tuple_element_t<_Indices, _Tuple>>(std::get<_Indices>(tuple))...};
+
+            return std::accumulate(_sizes, _sizes + std::tuple_size_v<_Tuple>, (size_t)0);
+        }
+
+        template <class _Tuple, class _Writer, size_t... _Indices>
+        void serialize_tuple_impl(_Writer &writer, const _Tuple &tuple, std::index_sequence<_Indices...>)
+        {
+            (writer << ... << std::get<_Indices>(tuple));
+        }
+
+        template <class _Ty, class _Reader>
+        struct deferred_object;
+
+        template <class _Variant, class _Reader, size_t... _Indices>
+        void deserialize_variant_impl(_Reader &reader, uint32_t index, _Variant &variant, std::index_sequence<_Indices...>)
+        {
+            using _Variant_deserializer_t = void (*)(_Reader &, _Variant &);
+
+            /* decode straight into the storage of the alternative, no temporary is moved into the variant */
+            constexpr _Variant_deserializer_t _table[] =
+                {
+                    [](_Reader &reader, _Variant &variant)
+                    {
+                        using value_type = std::variant_alternative_t<_Indices, _Variant>;
+
+                        if constexpr (std::is_default_constructible_v<value_type>)
+                            read_into(reader, variant.template emplace<_Indices>());
+                        else
+                            variant.template emplace<_Indices>(deferred_object<value_type, _Reader>{reader});
+                    }...};
+
+            _table[index](reader, variant);
+        }
+
+        template <class _Tuple, class _Reader, size_t... _Indices>
+        void deserialize_tuple_impl(_Reader &reader, _Tuple &tuple, std::index_sequence<_Indices...>)
+        {
+            (read_into(reader, std::get<_Indices>(tuple)), ...);
+        }
+    }
+
+    template <class _Ty>
+    constexpr void get_object_size(const _Ty &object, std::size_t &size)
+    {
+        constexpr std::size_t header_size = sizeof(data_header);
+
+        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be serialized can not be pointer type");
+
+        if constexpr (has_get_size_v<_Ty>)
+        {
+            size += object.get_size();
+        }
+        else if constexpr (is_fixed_wire_size_v<_Ty>)
+        {
+            (void)object;
+
+            size += static_wire_size_v<_Ty>;
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::pair>)
+        {
+            size += sizeof(data_header);
+
+            get_object_size(object.first, size);
+            get_object_size(object.second, size);
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::variant>)
+        {
+            using _Variant = remove_cvref_t<_Ty>;
+
+            size += sizeof(detail::variant_index_t<_Variant>);
+
+            size += detail::get_variant_size_impl(object, std::make_index_sequence<std::variant_size_v<_Variant>>{});
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::tuple>)
+        {
+            using _Tuple = remove_cvref_t<_Ty>;
+
+            size += detail::get_tuple_size_impl(object, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
+        }
+        else if constexpr (detail::is_bit_vector_v<remove_cvref_t<_Ty>>)
+        {
+            size += header_size + detail::packed_bits_size(object.size());
+        }
+        else if constexpr (std::is_array_v<_Ty>)
+        {
+            size += header_size;
+
+            std::for_each(std::begin(object), std::end(object), [&size](auto &v)
+                          { get_object_size(v, size); });
+        }
+        else if constexpr (is_standard_container_v<remove_cvref_t<_Ty>>)
+        {
+            using value_type = typename remove_cvref_t<_Ty>::value_type;
+
+            size += header_size;
 
             /* with this constexpr, compiler can generate more efficient code */
             if constexpr (get_data_type<value_type>() < d_pod)
             {
-                size += sizeof(value_type) * object.size();
+                size += sizeof(value_type) * object.size();
+            }
+            else
+            {
+                std::for_each(object.begin(), object.end(), [&size](auto &v)
+                              { get_object_size(v, size); });
+            }
+        }
+        else if constexpr (has_iterator_v<remove_cvref_t<_Ty>> && has_value_type_v<remove_cvref_t<_Ty>>)
+        {
+            using value_type = typename remove_cvref_t<_Ty>::value_type;
+
+            size += header_size;
+
+            if constexpr (get_data_type<value_type>() < d_pod)
+            {
+                size += sizeof(value_type) * object.size();
+            }
+            else
+            {
+                std::for_each(object.begin(), object.end(), [&size](auto &v)
+                              { get_object_size(v, size); });
+            }
+        }
+        else if constexpr (detail::is_reflectable_v<remove_cvref_t<_Ty>>)
+        {
+            /* fields stored as they are take no header */
+            std::apply([&size](const auto &...fields)
+                       { ((size += detail::is_raw_v<remove_cvref_t<decltype(fields)>> ? sizeof(fields) : get_size(fields)), ...); },
+                       detail::tie_fields(object));
+        }
+        else if constexpr (detail::is_raw_v<remove_cvref_t<_Ty>>)
+        {
+            if constexpr (std::is_compound_v<_Ty>)
+            {
+                size += header_size;
+            }
+
+            size += sizeof(_Ty);
+        }
+        else
+        {
+            static_assert(
+                Always_false<_Ty>,
+                "_Ty must implement \"size_t _Ty::get_size() const\"");
+        }
+    }
+
+    /*
+     * Calculate the memory space size needed for serialization / deserialization of the object
+     */
+    template <class _Ty>
+    constexpr std::size_t get_size(const _Ty &object)
+    {
+        std::size_t result{};
+
+        get_object_size(object, result);
+
+        return result;
+    }
+
+    namespace detail
+    {
+        /* store a run of trivially copyable elements with one copy when the writer allows it */
+        template <class _Writer>
+        void write_raw(_Writer &writer, const void *data, std::size_t length)
+        {
+            /* empty containers may hand out a null pointer */
+            if (length == 0)
+                return;
+
+            auto _bytes = static_cast<const std::uint8_t *>(data);
+
+            if constexpr (has_write_bytes_v<_Writer>)
+            {
+                writer.write(_bytes, length);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < length; ++i)
+                    writer << _bytes[i];
+            }
+        }
+
+        /* load a run of trivially copyable elements with one bounds check and one copy when the reader allows it */
+        template <class _Reader>
+        void read_raw(_Reader &reader, void *data, std::size_t length)
+        {
+            /* empty containers may hand out a null pointer */
+            if (length == 0)
+                return;
+
+            auto _bytes = static_cast<std::uint8_t *>(data);
+
+            if constexpr (has_consume_bytes_v<_Reader>)
+            {
+                if (auto _data = reader.consume_bytes(length))
+                    memcpy(_bytes, _data, length);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < length; ++i)
+                    _bytes[i] = reader.template read<std::uint8_t>();
+            }
+        }
+
+        /* bit streams are stored in little endian words whatever the byte order of the host */
+        inline void store_word(std::uint8_t *out, std::uint64_t word)
+        {
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+            memcpy(out, &word, sizeof(word));
+#else
+            for (std::size_t i = 0; i < 8; ++i)
+                out[i] = static_cast<std::uint8_t>(word >> (8 * i));
+#endif
+        }
+
+        inline std::uint64_t load_word(const std::uint8_t *in)
+        {
+            std::uint64_t _word = 0;
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+            memcpy(&_word, in, sizeof(_word));
+#else
+            for (std::size_t i = 0; i < 8; ++i)
+                _word |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+#endif
+
+            return _word;
+        }
+
+        /* bits are packed and unpacked through a block of this many bytes, a word of 64 bits at a time */
+        constexpr std::size_t bit_block_size = 64;
+
+        /*
+         * Access to the words behind an iterator of std::vector<bool>, for the libraries whose layout is the wire
+         * layout. The standard gives no such access, gathering bit by bit through the iterators is the portable path.
+         */
+        template <class _Iter>
+        struct bit_words
+        {
+            static constexpr bool value = false;
+        };
+
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        /* libstdc++ keeps the bits in words lowest bit first, `_M_p` points to the word of the iterator */
+        template <>
+        struct bit_words<std::vector<bool>::iterator>
+        {
+            static constexpr bool value = true;
+
+            static std::uint8_t *data(const std::vector<bool>::iterator &it)
+            {
+                return reinterpret_cast<std::uint8_t *>(it._M_p);
+            }
+        };
+
+        template <>
+        struct bit_words<std::vector<bool>::const_iterator>
+        {
+            static constexpr bool value = true;
+
+            static const std::uint8_t *data(const std::vector<bool>::const_iterator &it)
+            {
+                return reinterpret_cast<const std::uint8_t *>(it._M_p);
+            }
+        };
+#endif
+
+        /*
+         * std::vector<bool> as a sequence of bits packed 8 per byte, lowest bit first, 1 byte per element before
+         * format 0.5. Whole bytes are copied from the words of the vector when `bit_words` allows it, the other bits
+         * are gathered 64 at a time through the iterators and stored as little endian words.
+         */
+        template <class _Writer, class _Alloc>
+        void write_bits(_Writer &writer, const std::vector<bool, _Alloc> &bits)
+        {
+            data_header _header{d_seq_container, static_cast<std::uint32_t>(bits.size())};
+
+            if (!format_since(writer, VERSION_BITS))
+            {
+                _header.set_sub_type(d_byte8);
+
+                writer << _header;
+
+                for (bool bit : bits)
+                    writer << static_cast<std::uint8_t>(bit);
+
+                return;
+            }
+
+            _header.set_sub_type(d_bits);
+
+            writer << _header;
+
+            auto _it = bits.begin();
+            auto _count = bits.size();
+
+            if constexpr (bit_words<decltype(_it)>::value)
+            {
+                write_raw(writer, bit_words<decltype(_it)>::data(_it), _count / 8);
+
+                _it += static_cast<std::ptrdiff_t>(_count / 8 * 8);
+                _count %= 8;
+            }
+
+            std::uint8_t _block[bit_block_size];
+
+            while (_count != 0)
+            {
+                auto _n = (std::min)(_count, sizeof(_block) * 8);
+
+                for (std::size_t w = 0; w * 64 < _n; ++w)
+                {
+                    std::uint64_t _word = 0;
+
+                    for (std::size_t i = 0; i < 64 && w * 64 + i < _n; ++i, ++_it)
+                        _word |= static_cast<std::uint64_t>(*_it) << i;
+
+                    store_word(_block + w * 8, _word);
+                }
+
+                write_raw(writer, _block, packed_bits_size(_n));
+
+                _count -= _n;
+            }
+        }
+
+        template <class _Reader, class _Alloc>
+        void read_bits(_Reader &reader, data_header header, std::vector<bool, _Alloc> &bits)
+        {
+            bits.clear();
+
+            if (header.get_main_type() != d_seq_container)
+                return report_error(reader, error_code::type_mismatch);
+
+            /* written before format 0.5, 1 byte per element */
+            if (header.get_sub_type() == d_byte8)
+            {
+                if (header.length > reader.remaining())
+                    return report_error(reader, error_code::short_buffer);
+
+                bits.resize(header.length);
+
+                for (std::size_t i = 0; i < header.length; ++i)
+                    bits[i] = reader.template read<std::uint8_t>() != 0;
+
+                return;
+            }
+
+            if (header.get_sub_type() != d_bits)
+                return report_error(reader, error_code::type_mismatch);
+
+            if (packed_bits_size(header.length) > reader.remaining())
+                return report_error(reader, error_code::short_buffer);
+
+            bits.resize(header.length);
+
+            auto _it = bits.begin();
+            std::size_t _count = header.length;
+
+            if constexpr (bit_words<decltype(_it)>::value)
+            {
+                read_raw(reader, bit_words<decltype(_it)>::data(_it), _count / 8);
+
+                _it += static_cast<std::ptrdiff_t>(_count / 8 * 8);
+                _count %= 8;
+            }
+
+            /* the bytes past a partial last block are loaded with its last word but not used */
+            std::uint8_t _block[bit_block_size]{};
+
+            while (_count != 0)
+            {
+                auto _n = (std::min)(_count, sizeof(_block) * 8);
+
+                read_raw(reader, _block, packed_bits_size(_n));
+
+                for (std::size_t w = 0; w * 64 < _n; ++w)
+                {
+                    auto _word = load_word(_block + w * 8);
+
+                    for (std::size_t i = 0; i < 64 && w * 64 + i < _n; ++i, ++_it)
+                        *_it = (_word >> i) & 1;
+                }
+
+                _count -= _n;
+            }
+        }
+
+        /* elements per block of a sparse sequence, see `set_sparse` */
+        constexpr std::size_t sparse_block_size = 256;
+
+        /*
+         * Layout of a block, after its mode byte:
+         * dense: the elements as they are
+         * sparse / runs: uint8 count, a byte per entry (index of a non-zero element / length of a run - 1), the values
+         * xor (format 0.7, float and double): uint16 size of the bit stream in bytes and the bit stream, see
+         * `write_xor_block`
+         */
+        enum sparse_block : std::uint8_t
+        {
+            block_dense,
+            block_sparse,
+            block_runs,
+            block_xor
+        };
+
+        /* contiguous sequences of integers and floating point numbers */
+        template <class _Ty>
+        constexpr bool is_sparse_encodable_impl()
+        {
+            if constexpr (is_sequence_container_v<_Ty> && has_data_v<_Ty> && has_resize_v<_Ty> && !is_std_array_v<_Ty>)
+                return std::is_arithmetic_v<typename _Ty::value_type> && get_data_type<typename _Ty::value_type>() < d_pod;
+            else
+                return false;
+        }
+
+        template <class _Ty>
+        constexpr bool is_sparse_encodable_v = is_sparse_encodable_impl<_Ty>();
+
+        /* floating point numbers whose blocks may be XORed, see `set_xor_floats` */
+        template <class _Ty>
+        constexpr bool is_xor_encodable_v = std::is_floating_point_v<_Ty> && (sizeof(_Ty) == 4 || sizeof(_Ty) == 8);
+
+        template <class _Writer>
+        bool encodes_xor(const _Writer &writer)
+        {
+            if constexpr (std::is_base_of_v<format_state, _Writer>)
+                return writer.xor_floats() && writer.format() >= VERSION_XOR;
+            else
+                return false;
+        }
+
+        /* whether a sequence of `_Ty` is stored in blocks by `writer` */
+        template <class _Ty, class _Writer>
+        bool encodes_sparse(const _Writer &writer)
+        {
+            if constexpr (std::is_base_of_v<format_state, _Writer>)
+                return (writer.sparse() && writer.format() >= VERSION_SPARSE) || (is_xor_encodable_v<_Ty> && encodes_xor(writer));
+            else
+                return false;
+        }
+
+        /* stands in for the padding length behind the aligned flag of a sequence of scalars stored in blocks (format 0.6),
+           real padding is always shorter than a cache line */
+        constexpr std::uint8_t sparse_marker = 0xff;
+
+        /* elements are compared by their bits, -0.0 is not zero and a NaN equals itself */
+        template <class _Ty>
+        using sparse_bits_t = std::conditional_t<
+            sizeof(_Ty) == 1, std::uint8_t,
+            std::conditional_t<sizeof(_Ty) == 2, std::uint16_t, std::conditional_t<sizeof(_Ty) == 4, std::uint32_t, std::uint64_t>>>;
+
+        template <class _Ty>
+        sparse_bits_t<_Ty> load_bits(const _Ty *element)
+        {
+            sparse_bits_t<_Ty> bits;
+
+            memcpy(&bits, element, sizeof(bits));
+
+            return bits;
+        }
+
+        /*
+         * Smallest layout of a block of at least one element and its size, the non-zero elements and the runs are
+         * counted in a branch-free loop the compiler vectorizes (32-bit counters keep the lanes as wide as the elements)
+         */
+        template <class _Ty>
+        std::pair<sparse_block, std::size_t> choose_block(const _Ty *first, std::size_t count)
+        {
+            std::uint32_t _non_zero = load_bits(first) != 0;
+            std::uint32_t _runs = 1;
+
+            for (std::size_t i = 1; i < count; ++i)
+            {
+                const auto _bits = load_bits(first + i);
+
+                _non_zero += _bits != 0;
+                _runs += _bits != load_bits(first + i - 1);
+            }
+
+            /* a layout smaller than the dense one has less than `count` entries, the count fits in a byte */
+            const auto _dense = 1 + count * sizeof(_Ty);
+            const auto _sparse = 2 + _non_zero * (1 + sizeof(_Ty));
+            const auto _run_size = 2 + _runs * (1 + sizeof(_Ty));
+
+            if (_sparse < _dense && _sparse <= _run_size)
+                return {block_sparse, _sparse};
+
+            if (_run_size < _dense)
+                return {block_runs, _run_size};
+
+            return {block_dense, _dense};
+        }
+
+        /* number of leading zero bits of a non-zero word */
+        inline unsigned leading_zeros(std::uint64_t word)
+        {
+#if defined(_MSC_VER)
+            unsigned long _index;
+
+            _BitScanReverse64(&_index, word);
+
+            return 63u - static_cast<unsigned>(_index);
+#else
+            return static_cast<unsigned>(__builtin_clzll(word));
+#endif
+        }
+
+        /* number of trailing zero bits of a non-zero word */
+        inline unsigned trailing_zeros(std::uint64_t word)
+        {
+#if defined(_MSC_VER)
+            unsigned long _index;
+
+            _BitScanForward64(&_index, word);
+
+            return static_cast<unsigned>(_index);
+#else
+            return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+        }
+
+        /* appends fields of up to 64 bits, lowest bit first, a word at a time */
+        class bit_stream_writer
+        {
+        public:
+            explicit bit_stream_writer(std::uint8_t *out) : m_begin(out), m_out(out) {}
+
+            /* `value` has no bit set above `width` */
+            void put(std::uint64_t value, unsigned width)
+            {
+                m_word |= value << m_used;
+
+                if (m_used + width < 64)
+                {
+                    m_used += width;
+                    return;
+                }
+
+                store_word(m_out, m_word);
+
+                m_out += 8;
+                m_word = m_used == 0 ? 0 : value >> (64 - m_used);
+                m_used = m_used + width - 64;
+            }
+
+            /* flush the last word (the output takes up to 8 bytes more than the stream), return the stream size */
+            std::size_t finish()
+            {
+                store_word(m_out, m_word);
+
+                return static_cast<std::size_t>(m_out - m_begin) + (m_used + 7) / 8;
+            }
+
+        private:
+            std::uint8_t *m_begin;
+            std::uint8_t *m_out;
+            std::uint64_t m_word{0};
+            unsigned m_used{0};
+        };
+
+        /* reads the fields of `bit_stream_writer`, the input is followed by at least 24 readable bytes */
+        class bit_stream_reader
+        {
+        public:
+            explicit bit_stream_reader(const std::uint8_t *in) : m_in(in) {}
+
+            /* the next 57 bits at least */
+            std::uint64_t peek() const
+            {
+                return load_word(m_in + m_position / 8) >> (m_position % 8);
+            }
+
+            void skip(std::size_t width)
+            {
+                m_position += width;
+            }
+
+            /* a field of 1 to 64 bits */
+            std::uint64_t get(unsigned width)
+            {
+                const auto _in = m_in + m_position / 8;
+                const auto _shift = m_position % 8;
+
+                /* the bits past the first word, two shifts as `_shift` may be 0 */
+                const auto _value = load_word(_in) >> _shift | load_word(_in + 8) << 1 << (63 - _shift);
+
+                m_position += width;
+
+                return _value & ~std::uint64_t{0} >> (64 - width);
+            }
+
+            std::size_t position() const
+            {
+                return m_position;
+            }
+
+        private:
+            const std::uint8_t *m_in;
+            std::size_t m_position{0};
+        };
+
+        /* bits of the length of a window of meaningful bits, less one */
+        template <class _Ty>
+        constexpr unsigned xor_length_bits = sizeof(_Ty) == 8 ? 6 : 5;
+
+        /* largest bit stream of a block, plus the word `bit_stream_writer` may write past it */
+        template <class _Ty>
+        constexpr std::size_t xor_block_capacity = (sparse_block_size * (7 + xor_length_bits<_Ty> + 8 * sizeof(_Ty)) + 7) / 8 + 8;
+
+        /*
+         * Bit stream of the XOR layout of a block, return its size in bytes
+         *
+         * Every element is XORed with the one before it (`previous` for the first one, 0 at the start of the sequence)
+         * and stored as:
+         *   0                                         the same bits as the element before
+         *   1, 0, the window bits of the XOR          the XOR has no bit set outside the window
+         *   1, 1, 5-bit leading zeros, length - 1     a new window of the set bits of the XOR, the length takes 5
+         *   (5 or 6 bits), the window bits            bits for float and 6 for double, leading zeros are capped at 31
+         * There is no window at the start of a block.
+         */
+        template <class _Ty>
+        std::size_t write_xor_block(std::uint8_t *out, sparse_bits_t<_Ty> previous, const _Ty *first, std::size_t count)
+        {
+            constexpr unsigned _width = 8 * sizeof(_Ty);
+            constexpr unsigned _extra = 64 - _width;
+
+            bit_stream_writer _stream{out};
+
+            /* an empty window at first, no XOR fits it */
+            unsigned _leading = _width;
+            unsigned _trailing = 0;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto _bits = load_bits(first + i);
+                const auto _xor = static_cast<std::uint64_t>(_bits ^ previous);
+
+                previous = _bits;
+
+                if (_xor == 0)
+                {
+                    _stream.put(0, 1);
+                    continue;
+                }
+
+                const auto _lz = (std::min)(leading_zeros(_xor) - _extra, 31u);
+                const auto _tz = trailing_zeros(_xor);
+
+                if (_lz >= _leading && _tz >= _trailing)
+                {
+                    _stream.put(1, 2);
+                    _stream.put(_xor >> _trailing, _width - _leading - _trailing);
+
+                    continue;
+                }
+
+                const auto _length = _width - _lz - _tz;
+
+                _leading = _lz;
+                _trailing = _tz;
+
+                _stream.put(3u | _lz << 2 | (_length - 1) << 7, 7 + xor_length_bits<_Ty>);
+                _stream.put(_xor >> _tz, _length);
+            }
+
+            return _stream.finish();
+        }
+
+        /*
+         * Decode `count` elements from a bit stream of `size` bytes followed by 24 readable bytes, tell if the stream
+         * was well-formed
+         */
+        template <class _Ty>
+        bool read_xor_block(const std::uint8_t *in, std::size_t size, sparse_bits_t<_Ty> previous, _Ty *first, std::size_t count)
+        {
+            using bits_type = sparse_bits_t<_Ty>;
+
+            constexpr unsigned _width = 8 * sizeof(_Ty);
+            constexpr unsigned _header_bits = 7 + xor_length_bits<_Ty>;
+
+            bit_stream_reader _stream{in};
+
+            unsigned _leading = _width;
+            unsigned _trailing = 0;
+
+            /* every element reads at most 77 bits, checking once per element keeps the reads within the slack */
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto _control = _stream.peek();
+
+                if ((_control & 1) == 0)
+                {
+                    _stream.skip(1);
+                }
+                else
+                {
+                    if ((_control & 2) != 0)
+                    {
+                        const auto _length = static_cast<unsigned>(_control >> 7 & ((1u << xor_length_bits<_Ty>) - 1)) + 1;
+
+                        _leading = static_cast<unsigned>(_control >> 2 & 31);
+
+                        if (_leading + _length > _width)
+                            return false;
+
+                        _trailing = _width - _leading - _length;
+
+                        _stream.skip(_header_bits);
+                    }
+                    else
+                    {
+                        /* no window to reuse yet */
+                        if (_leading == _width)
+                            return false;
+
+                        _stream.skip(2);
+                    }
+
+                    previous ^= static_cast<bits_type>(_stream.get(_width - _leading - _trailing) << _trailing);
+                }
+
+                if (_stream.position() > size * 8)
+                    return false;
+
+                memcpy(first + i, &previous, sizeof(_Ty));
+            }
+
+            return true;
+        }
+
+        /*
+         * Store a sequence of scalars in blocks behind its header if that is smaller than storing it as it is, tell if
+         * it was done
+         */
+        template <class _Writer, class _Ty>
+        bool write_sparse(_Writer &writer, data_header header, const _Ty *first, std::size_t count)
+        {
+            std::vector<sparse_block> _modes{};
+            std::size_t _size = 0;
+
+            /* XOR blocks are encoded once, behind their mode byte and size, and copied out if they are kept */
+            std::vector<std::uint8_t> _xor_blocks{};
+
+            [[maybe_unused]] const bool _xor = encodes_xor(writer);
+
+            _modes.reserve(count / sparse_block_size + 1);
+
+            for (std::size_t i = 0; i < count; i += sparse_block_size)
+            {
+                const auto _n = (std::min)(sparse_block_size, count - i);
+
+                auto [_mode, _block_size] = choose_block(first + i, _n);
+
+                /* the XOR layout takes a bit per element at least, it cannot beat blocks of zeros or long runs */
+                if constexpr (is_xor_encodable_v<_Ty>)
+                {
+                    if (_xor && _block_size > 3 + (_n + 7) / 8)
+                    {
+                        std::uint8_t _block[3 + xor_block_capacity<_Ty>];
+
+                        const auto _previous = i == 0 ? sparse_bits_t<_Ty>{0} : load_bits(first + i - 1);
+                        const auto _stream_size = write_xor_block(_block + 3, _previous, first + i, _n);
+
+                        if (3 + _stream_size < _block_size)
+                        {
+                            const auto _size16 = static_cast<std::uint16_t>(_stream_size);
+
+                            _block[0] = block_xor;
+
+                            memcpy(_block + 1, &_size16, sizeof(_size16));
+
+                            _xor_blocks.insert(_xor_blocks.end(), _block, _block + 3 + _stream_size);
+
+                            _mode = block_xor;
+                            _block_size = 3 + _stream_size;
+                        }
+                    }
+                }
+
+                _modes.push_back(_mode);
+                _size += _block_size;
+            }
+
+            /* the marker takes a byte of its own */
+            if (sizeof(sparse_marker) + _size >= count * sizeof(_Ty))
+                return false;
+
+            header.length |= data_header::aligned_flag;
+
+            writer << header << sparse_marker;
+
+            std::uint8_t _block[2 + sparse_block_size * (1 + sizeof(_Ty))];
+            std::size_t _xor_offset = 0;
+
+            for (std::size_t i = 0; i < count; i += sparse_block_size)
+            {
+                const auto _n = (std::min)(sparse_block_size, count - i);
+                const auto _elements = first + i;
+                const auto _mode = _modes[i / sparse_block_size];
+
+                _block[0] = _mode;
+
+                if (_mode == block_dense)
+                {
+                    write_raw(writer, _block, 1);
+                    write_raw(writer, _elements, _n * sizeof(_Ty));
+
+                    continue;
+                }
+
+                if (_mode == block_xor)
+                {
+                    std::uint16_t _stream_size;
+
+                    memcpy(&_stream_size, _xor_blocks.data() + _xor_offset + 1, sizeof(_stream_size));
+
+                    write_raw(writer, _xor_blocks.data() + _xor_offset, 3 + _stream_size);
+
+                    _xor_offset += 3 + _stream_size;
+
+                    continue;
+                }
+
+                /* the values are gathered behind the largest possible index table and moved up once it is complete */
+                std::size_t _entries = 0;
+
+                auto _values = _block + 2 + sparse_block_size;
+
+                if (_mode == block_sparse)
+                {
+                    /* a group of zeros is passed over with a single test */
+                    for (std::size_t j = 0; j < _n; j += 16)
+                    {
+                        const auto _end = (std::min)(j + 16, _n);
+
+                        sparse_bits_t<_Ty> _any = 0;
+
+                        for (std::size_t k = j; k < _end; ++k)
+                            _any |= load_bits(_elements + k);
+
+                        if (_any == 0)
+                            continue;
+
+                        for (std::size_t k = j; k < _end; ++k)
+                        {
+                            if (load_bits(_elements + k) != 0)
+                            {
+                                _block[2 + _entries] = static_cast<std::uint8_t>(k);
+
+                                memcpy(_values + _entries++ * sizeof(_Ty), _elements + k, sizeof(_Ty));
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    for (std::size_t j = 0, k = 0; j < _n; j = k)
+                    {
+                        for (k = j + 1; k < _n && load_bits(_elements + k) == load_bits(_elements + j); ++k)
+                            ;
+
+                        _block[2 + _entries] = static_cast<std::uint8_t>(k - j - 1);
+
+                        memcpy(_values + _entries++ * sizeof(_Ty), _elements + j, sizeof(_Ty));
+                    }
+                }
+
+                _block[1] = static_cast<std::uint8_t>(_entries);
+
+                memmove(_block + 2 + _entries, _values, _entries * sizeof(_Ty));
+
+                write_raw(writer, _block, 2 + _entries * (1 + sizeof(_Ty)));
+            }
+
+            return true;
+        }
+
+        /* expand the blocks of a sparse sequence of `count` elements into `object` */
+        template <class _Reader, class _Ty>
+        void read_sparse(_Reader &reader, std::size_t count, _Ty &object)
+        {
+            using value_type = typename _Ty::value_type;
+
+            std::uint8_t _block[sparse_block_size * (1 + sizeof(value_type))];
+
+            /* every block takes at least 2 bytes */
+            if ((count + sparse_block_size - 1) / sparse_block_size > reader.remaining() / 2)
+                return report_error(reader, error_code::short_buffer);
+
+            object.resize(count);
+
+            for (std::size_t i = 0; i < count && reader.good(); i += sparse_block_size)
+            {
+                const auto _n = (std::min)(sparse_block_size, count - i);
+
+                auto _elements = object.data() + i;
+                auto _mode = reader.template read<std::uint8_t>();
+
+                if (_mode == block_dense)
+                {
+                    read_raw(reader, _elements, _n * sizeof(value_type));
+                    continue;
+                }
+
+                if (_mode == block_xor)
+                {
+                    if constexpr (is_xor_encodable_v<value_type>)
+                    {
+                        std::uint8_t _stream[xor_block_capacity<value_type> + 24];
+
+                        std::size_t _stream_size = reader.template read<std::uint16_t>();
+
+                        if (_stream_size > xor_block_capacity<value_type>)
+                            return report_error(reader, error_code::length_mismatch);
+
+                        read_raw(reader, _stream, _stream_size);
+
+                        if (!reader.good())
+                            return;
+
+                        memset(_stream + _stream_size, 0, 24);
+
+                        const auto _previous = i == 0 ? sparse_bits_t<value_type>{0} : load_bits(_elements - 1);
+
+                        if (!read_xor_block(_stream, _stream_size, _previous, _elements, _n))
+                            return report_error(reader, error_code::length_mismatch);
+
+                        continue;
+                    }
+                    else
+                    {
+                        return report_error(reader, error_code::type_mismatch);
+                    }
+                }
+
+                std::size_t _entries = reader.template read<std::uint8_t>();
+
+                read_raw(reader, _block, _entries * (1 + sizeof(value_type)));
+
+                if (!reader.good())
+                    return;
+
+                const auto _values = _block + _entries;
+
+                if (_mode == block_sparse)
+                {
+                    for (std::size_t k = 0; k < _entries; ++k)
+                    {
+                        if (_block[k] >= _n)
+                            return report_error(reader, error_code::invalid_index);
+
+                        memcpy(_elements + _block[k], _values + k * sizeof(value_type), sizeof(value_type));
+                    }
+                }
+                else if (_mode == block_runs)
+                {
+                    std::size_t _pos = 0;
+
+                    for (std::size_t k = 0; k < _entries; ++k)
+                    {
+                        const std::size_t _length = _block[k] + 1u;
+
+                        if (_length > _n - _pos)
+                            return report_error(reader, error_code::length_mismatch);
+
+                        value_type _value;
+
+                        memcpy(&_value, _values + k * sizeof(value_type), sizeof(value_type));
+
+                        std::fill_n(_elements + _pos, _length, _value);
+
+                        _pos += _length;
+                    }
+
+                    if (_pos != _n)
+                        return report_error(reader, error_code::length_mismatch);
+                }
+                else
+                {
+                    return report_error(reader, error_code::type_mismatch);
+                }
+            }
+        }
+
+        /* check the bit stream of a XOR block of `count` elements, it is decoded into a scratch block */
+        template <class _Ty, class _Reader>
+        void skip_xor_block(_Reader &reader, std::size_t count)
+        {
+            std::uint8_t _stream[xor_block_capacity<_Ty> + 24];
+            _Ty _elements[sparse_block_size];
+
+            std::size_t _stream_size = reader.template read<std::uint16_t>();
+
+            if (_stream_size > xor_block_capacity<_Ty>)
+                return report_error(reader, error_code::length_mismatch);
+
+            read_raw(reader, _stream, _stream_size);
+
+            if (!reader.good())
+                return;
+
+            memset(_stream + _stream_size, 0, 24);
+
+            if (!read_xor_block(_stream, _stream_size, sparse_bits_t<_Ty>{0}, _elements, count))
+                report_error(reader, error_code::length_mismatch);
+        }
+
+        /*
+         * Skip the blocks of a sparse sequence of `count` elements of scalar type `dt`
+         * Every block is checked like `read_sparse` does, so whatever is skipped can be read.
+         */
+        template <class _Reader>
+        void skip_sparse(_Reader &reader, data_type dt, std::size_t count)
+        {
+            const auto _size = scalar_wire_size(dt);
+
+            if (_size == 0)
+                return report_error(reader, error_code::type_mismatch);
+
+            std::uint8_t _entries_block[sparse_block_size];
+
+            if ((count + sparse_block_size - 1) / sparse_block_size > reader.remaining() / 2)
+                return report_error(reader, error_code::short_buffer);
+
+            for (std::size_t i = 0; i < count && reader.good(); i += sparse_block_size)
+            {
+                const auto _n = (std::min)(sparse_block_size, count - i);
+                const auto _mode = reader.template read<std::uint8_t>();
+
+                if (_mode == block_dense)
+                {
+                    reader.skip(_n * _size);
+                }
+                else if (_mode == block_sparse || _mode == block_runs)
+                {
+                    std::size_t _entries = reader.template read<std::uint8_t>();
+
+                    read_raw(reader, _entries_block, _entries);
+
+                    if (!reader.good())
+                        return;
+
+                    if (_mode == block_sparse)
+                    {
+                        for (std::size_t k = 0; k < _entries; ++k)
+                        {
+                            if (_entries_block[k] >= _n)
+                                return report_error(reader, error_code::invalid_index);
+                        }
+                    }
+                    else
+                    {
+                        std::size_t _pos = 0;
+
+                        for (std::size_t k = 0; k < _entries; ++k)
+                            _pos += _entries_block[k] + 1u;
+
+                        if (_pos != _n)
+                            return report_error(reader, error_code::length_mismatch);
+                    }
+
+                    reader.skip(_entries * _size);
+                }
+                else if (_mode == block_xor)
+                {
+                    if (dt == d_float32)
+                        skip_xor_block<float>(reader, _n);
+                    else if (dt == d_float64)
+                        skip_xor_block<double>(reader, _n);
+                    else
+                        return report_error(reader, error_code::type_mismatch);
+                }
+                else
+                {
+                    return report_error(reader, error_code::type_mismatch);
+                }
+            }
+        }
+
+        /* padding in front of an array is capped at a cache line */
+        constexpr std::size_t max_array_alignment = 64;
+
+        template <class _Ty>
+        constexpr std::size_t array_alignment_v = (std::min)(alignof(_Ty), max_array_alignment);
+
+        /* contiguous sequences of trivially copyable elements, padded to the alignment of the elements on request */
+        template <class _Ty>
+        constexpr bool is_alignable_impl()
+        {
+            if constexpr (is_sequence_container_v<_Ty> && has_data_v<_Ty>)
+                return is_raw_v<typename _Ty::value_type> && alignof(typename _Ty::value_type) > 1;
+            else
+                return false;
+        }
+
+        template <class _Ty>
+        constexpr bool is_alignable_v = is_alignable_impl<_Ty>();
+
+        template <class _Writer>
+        bool pads_arrays(const _Writer &writer)
+        {
+            if constexpr (std::is_base_of_v<format_state, _Writer>)
+                return writer.aligned() && writer.format() >= VERSION_ALIGNED;
+            else
+                return false;
+        }
+
+        /* uint8 padding length and the padding, the elements behind it start at a multiple of `alignment` */
+        template <class _Writer>
+        void write_padding(_Writer &writer, std::size_t alignment)
+        {
+            static constexpr std::uint8_t _zeros[max_array_alignment]{};
+
+            auto _pad = static_cast<std::uint8_t>((alignment - (writer.count() + 1) % alignment) % alignment);
+
+            writer << _pad;
+
+            write_raw(writer, _zeros, _pad);
+        }
+
+        template <class _Reader>
+        void skip_padding(_Reader &reader, std::uint8_t _pad)
+        {
+            if (_pad >= max_array_alignment)
+                return report_error(reader, error_code::length_mismatch);
+
+            if constexpr (has_consume_bytes_v<_Reader>)
+            {
+                (void)reader.consume_bytes(_pad);
+            }
+            else
+            {
+                for (std::uint8_t i = 0; i < _pad; ++i)
+                    (void)reader.template read<std::uint8_t>();
+            }
+        }
+
+        /* strip the aligned flag off the header of a sequence and skip the padding it announces,
+           tell if the sparse marker stood in place of the padding */
+        template <class _Reader>
+        bool take_padding(_Reader &reader, data_header &header)
+        {
+            if (header.get_main_type() != d_seq_container || !header.take_aligned_flag())
+                return false;
+
+            auto _pad = reader.template read<std::uint8_t>();
+
+            if (_pad == sparse_marker && format_since(reader, VERSION_SPARSE) && scalar_wire_size(header.get_sub_type()) != 0)
+                return true;
+
+            skip_padding(reader, _pad);
+
+            return false;
+        }
+
+        /* decode the elements of a std::array or a C array in place, the length on the wire must match */
+        template <class _Reader, class _Ty>
+        void read_array_elements(_Reader &reader, data_header header, _Ty *first, std::size_t count)
+        {
+            /* fixed-size arrays are decoded from a region of their static size, which leaves no room for padding */
+            if (header.take_aligned_flag())
+                return report_error(reader, error_code::type_mismatch);
+
+            if (header.get_main_type() != d_seq_container || !header.template is_subtype_compitable<_Ty>())
+                return report_error(reader, error_code::type_mismatch);
+
+            if (header.length != count)
+                return report_error(reader, error_code::length_mismatch);
+
+            if constexpr (is_raw_v<_Ty>)
+            {
+                read_raw(reader, first, sizeof(_Ty) * count);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    read_into(reader, first[i]);
+            }
+        }
+
+        template <class _Reader, class _Ty>
+        void read_into(_Reader &reader, _Ty &value)
+        {
+            if constexpr (std::is_array_v<_Ty> && is_raw_v<_Ty>)
+            {
+                read_raw(reader, value, sizeof(_Ty));
+            }
+            else if constexpr (std::is_array_v<_Ty>)
+            {
+                read_array_elements(reader, reader.template read<data_header>(), value, std::extent_v<_Ty>);
+            }
+            else if constexpr (is_raw_v<_Ty>)
+            {
+                value = reader.template read<_Ty>();
+            }
+            else
+            {
+                deserialize_object_into(reader, value);
+            }
+        }
+    }
+
+    namespace detail
+    {
+        /* a string is a seq_container of byte8 stored with one copy, or a reference into the string table */
+        template <class _Writer>
+        void write_string(_Writer &writer, const std::string &value)
+        {
+            if (auto _strings = string_table_of(writer))
+            {
+                if (auto _index = _strings->find_or_add(value))
+                {
+                    writer << data_header{d_string_ref, *_index};
+                    return;
+                }
+            }
+
+            data_header _header{d_seq_container, static_cast<std::uint32_t>(value.size())};
+
+            _header.set_sub_type(d_byte8);
+
+            writer << _header;
+
+            write_raw(writer, value.data(), value.size());
+        }
+
+        /* characters of the string at the reader position, they stay in the buffer or in the string table */
+        template <class _Reader>
+        std::string_view read_string_view(_Reader &reader)
+        {
+            auto _header = reader.template read<data_header>();
+
+            if (!reader.good())
+                return {};
+
+            auto _strings = string_table_of(reader);
+
+            if (_header.get_main_type() == d_string_ref)
+            {
+                auto _view = _strings ? _strings->find(_header.length) : nullptr;
+
+                if (!_view)
+                {
+                    report_error(reader, error_code::invalid_index);
+                    return {};
+                }
+
+                return *_view;
+            }
+
+            if (_header.get_main_type() != d_seq_container || _header.get_sub_type() != d_byte8)
+            {
+                report_error(reader, error_code::type_mismatch);
+                return {};
+            }
+
+            auto _data = reader.consume_bytes(_header.length);
+
+            if (!_data)
+                return {};
+
+            std::string_view _view{reinterpret_cast<const char *>(_data), _header.length};
+
+            if (_strings)
+                _strings->add(_view);
+
+            return _view;
+        }
+    }
+
+    /*
+     * Serialize a object to binary format
+     */
+    template <class _Ty, class _Writer = bytes_writer>
+    void serialize_object(_Writer &writer, const _Ty &object)
+    {
+        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be serialized can not be pointer type");
+
+        _ZPACKER_STATS_SCOPE(_Ty, writer, true);
+
+        /* check the capacity once for the whole fixed-size subtree and store the fields unchecked */
+        if constexpr (is_fixed_wire_size_v<_Ty> && has_reserve_bytes_v<_Writer>)
+        {
+            if (detail::compact_layout(writer))
+            {
+                if (auto _data = writer.reserve_bytes(static_wire_size_v<_Ty>))
+                {
+                    bytes_writer_unchecked _writer{_data};
+
+                    serialize_object(_writer, object);
+                }
+
+                return;
+            }
+        }
+
+        if constexpr (has_serialize_v<_Ty>)
+        {
+            object.serialize(writer);
+        }
+        else if constexpr (detail::is_reflectable_v<remove_cvref_t<_Ty>>)
+        {
+            detail::write_fields(writer, object);
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::pair>)
+        {
+            data_header _header{d_pair, 2};
+
+            writer << _header;
+
+            writer << object.first;
+            writer << object.second;
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::variant>)
+        {
+            using _Variant = remove_cvref_t<_Ty>;
+
+            if (detail::compact_layout(writer))
+            {
+                writer << static_cast<detail::variant_index_t<_Variant>>(object.index());
+
+                std::visit([&writer](auto &&val)
+                           { writer << val; }, object);
+
+                return;
+            }
+
+            data_header _header{d_variant, std::variant_size_v<_Variant>};
+
+            std::visit([&_header, &writer, &object](auto &&val)
+                       {
+				using value_type = std::decay_t<decltype(val)>;
+
+				_header.set_sub_type(get_data_type<value_type>());
+
+				writer << _header << static_cast<uint32_t>(object.index()) << val; }, object);
+        }
+        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::tuple>)
+        {
+            using _Tuple = remove_cvref_t<_Ty>;
+
+            /* the arity is known by the reader, only the old layout stores it */
+            if (!detail::compact_layout(writer))
+                writer << data_header{d_tuple, std::tuple_size_v<_Tuple>};
+
+            detail::serialize_tuple_impl(writer, object, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
+        }
+        /* C arrays of trivially copyable types are stored as they are, the others like std::array */
+        else if constexpr (std::is_array_v<_Ty>)
+        {
+            using value_type = std::remove_extent_t<_Ty>;
+
+            data_header _header{d_seq_container, static_cast<std::uint32_t>(std::extent_v<_Ty>)};
+
+            _header.set_sub_type(get_data_type<value_type>());
+
+            _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, true);
+
+            writer << _header;
+
+            std::for_each(std::begin(object), std::end(object), [&writer](auto &v)
+                          { writer << v; });
+        }
+        else if constexpr (std::is_same_v<remove_cvref_t<_Ty>, std::string>)
+        {
+            _ZPACKER_STATS_ELEMENTS(_Ty, object.size(), true);
+
+            detail::write_string(writer, object);
+        }
+        else if constexpr (detail::is_bit_vector_v<remove_cvref_t<_Ty>>)
+        {
+            _ZPACKER_STATS_ELEMENTS(_Ty, object.size(), true);
+
+            detail::write_bits(writer, object);
+        }
+        else if constexpr (is_standard_container_v<remove_cvref_t<_Ty>>)
+        {
+            using container_type = remove_cvref_t<_Ty>;
+            using value_type = typename container_type::value_type;
+
+            data_header _header{};
+
+            if constexpr (is_sequence_container_v<container_type>)
+            {
+                _header.set_main_type(d_seq_container);
+                _header.set_sub_type(get_data_type<value_type>());
+            }
+            else if constexpr (is_associated_container_v<container_type>)
+            {
+                _header.set_main_type(d_aso_container);
+                _header.set_sub_type(get_data_type<value_type>());
+            }
+            /* std::array, std::initializer_list, etc. */
+            else
+            {
+                _header.set_main_type(d_seq_container);
+                _header.set_sub_type(get_data_type<value_type>());
+            }
+
+            _header.length = static_cast<std::uint32_t>(object.size());
+
+            _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, true);
+
+            /* lets the reader append to an ordered container instead of searching for every element */
+            if constexpr (has_key_compare_v<container_type>)
+            {
+                if (detail::format_since(writer, VERSION_ORDERED))
+                    _header.length |= data_header::ordered_flag;
+            }
+
+            /* lets the reader hand out the elements in place, see `read_array_view`, std::array is never padded */
+            bool _padded = false;
+
+            if constexpr (detail::is_alignable_v<container_type>)
+            {
+                if (detail::pads_arrays(writer))
+                {
+                    _header.length |= data_header::aligned_flag;
+                    _padded = true;
+                }
+            }
+
+            if constexpr (detail::is_sparse_encodable_v<container_type>)
+            {
+                if (!_padded && detail::encodes_sparse<value_type>(writer) && detail::write_sparse(writer, _header, object.data(), object.size()))
+                    return;
+            }
+
+            writer << _header;
+
+            if (_padded)
+                detail::write_padding(writer, detail::array_alignment_v<value_type>);
+
+            /* contiguous elements stored as they are go out with one copy */
+            if constexpr ((is_std_array_v<container_type> || (is_sequence_container_v<container_type> && has_data_v<container_type>)) &&
+                          detail::is_raw_v<value_type>)
+            {
+                detail::write_raw(writer, object.data(), sizeof(value_type) * object.size());
+            }
+            else
+            {
+                std::for_each(object.begin(), object.end(), [&writer](auto &v)
+                              { writer << v; });
+            }
+        }
+        /* std::forward_list goes here */
+        else if constexpr (has_iterator_v<remove_cvref_t<_Ty>> && has_value_type_v<remove_cvref_t<_Ty>>)
+        {
+            using container_type = remove_cvref_t<_Ty>;
+            using value_type = typename container_type::value_type;
+
+            data_header _header{};
+
+            _header.set_main_type(d_seq_container);
+            _header.set_sub_type(get_data_type<value_type>());
+
+            if constexpr (has_size_v<container_type>)
+            {
+                _header.length = static_cast<std::uint32_t>(object.size());
+
+                _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, true);
+
+                writer << _header;
+
+                std::for_each(object.begin(), object.end(), [&writer](auto &v)
+                              { writer << v; });
+            }
+            else
+            {
+                std::uint32_t _size{0};
+                std::vector<std::uint8_t> _partial;
+
+                _partial.reserve(_default_reserve_size);
+
+                bytes_writer _writer{_partial};
+
+                detail::copy_format(writer, _writer);
+
+                std::for_each(object.begin(), object.end(), [&_writer, &_partial, &_size](auto &v)
+                              {
+					_writer << v;
+					++_size; });
+
+                _header.length = _size;
+
+                _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, true);
+
+                _partial.shrink_to_fit();
+
+                writer << _header;
+
+                writer.write(_partial);
+            }
+        }
+        else if constexpr (detail::is_raw_v<remove_cvref_t<_Ty>>)
+        {
+            if constexpr (std::is_compound_v<_Ty>)
+            {
+                writer << data_header{d_pod, static_cast<std::uint32_t>(sizeof(_Ty))};
+            }
+
+            writer << object;
+        }
+        else
+        {
+            static_assert(
+                Always_false<_Ty>,
+                "_Ty to serialize must be either of a standard STL container type, custom containers that implement standard iterator, "
+                "POD type or custom types that implement serialize() method");
+        }
+    }
+
+    namespace detail
+    {
+        /* converts to `_Ty` by decoding it, handed to emplace so that the element is constructed in place */
+        template <class _Ty, class _Reader>
+        struct deferred_object
+        {
+            _Reader &reader;
+
+            operator _Ty() const
+            {
+                return reader.template read<_Ty>();
+            }
+        };
+
+        template <class _Ty, class _Reader>
+        deferred_object<_Ty, _Reader> defer_object(_Reader &reader)
+        {
+            return {reader};
+        }
+
+        /* types that can not be decoded into an existing object */
+        template <class _Ty, class _Reader>
+        constexpr bool is_constructed_on_read_v =
+            has_deserialize_v<_Ty> || has_deserialize_constructor_v<_Ty, _Reader> ||
+            !std::is_default_constructible_v<_Ty> || !std::is_move_assignable_v<_Ty>;
+
+        /* the object representation of a `_Ty`, to be copied into where `_Ty` itself can not */
+        template <class _Ty>
+        struct raw_storage
+        {
+            alignas(_Ty) std::uint8_t bytes[sizeof(_Ty)];
+        };
+
+        /* a trivially copyable map element is stored as it is, its key is const so the halves are copied out one by one */
+        template <class _Container, class _Reader>
+        auto read_map_element(_Reader &reader)
+        {
+            using value_type = typename _Container::value_type;
+            using key_type = typename _Container::key_type;
+            using mapped_type = typename _Container::mapped_type;
+
+            auto _storage = reader.template read<raw_storage<value_type>>();
+
+            std::pair<key_type, mapped_type> _element{};
+
+            memcpy(std::addressof(_element.first), _storage.bytes + offsetof(value_type, first), sizeof(key_type));
+            memcpy(std::addressof(_element.second), _storage.bytes + offsetof(value_type, second), sizeof(mapped_type));
+
+            return _element;
+        }
+
+        /*
+         * decode the next element of a container straight into the container
+         * `_AtEnd` hints an ordered container that the element goes last, the insertion is amortized O(1) then
+         */
+        template <bool _AtEnd = false, class _Container, class _Reader>
+        void emplace_element(_Reader &reader, _Container &container)
+        {
+            using value_type = typename _Container::value_type;
+
+            if constexpr (is_sequence_container_v<_Container>)
+            {
+                if constexpr (std::is_trivially_copyable_v<value_type> || !has_emplace_back_v<_Container>)
+                {
+                    container.push_back(reader.template read<value_type>());
+                }
+                else if constexpr (is_constructed_on_read_v<value_type, _Reader>)
+                {
+                    container.emplace_back(defer_object<value_type>(reader));
+                }
+                else
+                {
+                    container.emplace_back();
+
+                    read_into(reader, container.back());
+                }
+            }
+            else if constexpr (std::is_trivially_copyable_v<value_type> && has_mapped_type_v<_Container>)
+            {
+                auto _element = read_map_element<_Container>(reader);
+
+                if constexpr (_AtEnd)
+                    container.insert(container.end(), std::move(_element));
+                else
+                    container.insert(std::move(_element));
+            }
+            else if constexpr (std::is_trivially_copyable_v<value_type> || !has_emplace_v<_Container>)
+            {
+                if constexpr (_AtEnd)
+                    container.insert(container.end(), reader.template read<value_type>());
+                else
+                    container.insert(reader.template read<value_type>());
+            }
+            else if constexpr (has_mapped_type_v<_Container>)
+            {
+                /* key and mapped value are decoded into the node, no pair is built aside */
+                auto _header = reader.template read<data_header>();
+
+                if (_header.length != 2 || _header.get_main_type() != d_pair)
+                    return report_error(reader, error_code::type_mismatch);
+
+                using key_type = typename _Container::key_type;
+                using mapped_type = typename _Container::mapped_type;
+
+                if constexpr (_AtEnd)
+                    container.emplace_hint(container.end(), std::piecewise_construct,
+                                           std::forward_as_tuple(defer_object<key_type>(reader)),
+                                           std::forward_as_tuple(defer_object<mapped_type>(reader)));
+                else
+                    container.emplace(std::piecewise_construct,
+                                      std::forward_as_tuple(defer_object<key_type>(reader)),
+                                      std::forward_as_tuple(defer_object<mapped_type>(reader)));
+            }
+            else if constexpr (_AtEnd)
+            {
+                container.emplace_hint(container.end(), defer_object<value_type>(reader));
+            }
+            else
+            {
+                container.emplace(defer_object<value_type>(reader));
+            }
+        }
+
+        template <class _Tuple, class _Reader, size_t... _Indices>
+        _Tuple construct_tuple_impl(_Reader &reader, std::index_sequence<_Indices...>)
+        {
+            /* the elements of a braced list are evaluated in order */
+            return _Tuple{reader.template read<std::tuple_element_t<_Indices, _Tuple>>()...};
+        }
+
+        template <class _Ty, class _Reader>
+        _Ty construct_object(_Reader &reader)
+        {
+            _ZPACKER_STATS_SCOPE(_Ty, reader, false);
+
+            if constexpr (has_deserialize_v<_Ty>)
+            {
+                return _Ty::deserialize(reader);
+            }
+            else if constexpr (has_deserialize_constructor_v<_Ty, _Reader>)
+            {
+                return _Ty(deserialize_tag, reader);
+            }
+            else if constexpr (is_specialize_of_v<_Ty, std::pair>)
+            {
+                auto _header = reader.template read<data_header>();
+
+                // runtime check
+                if (_header.length != 2 || _header.get_main_type() != d_pair)
+                    report_error(reader, error_code::type_mismatch);
+
+                return _Ty{reader.template read<typename _Ty::first_type>(), reader.template read<typename _Ty::second_type>()};
+            }
+            else if constexpr (is_specialize_of_v<_Ty, std::tuple>)
+            {
+                if (!compact_layout(reader))
+                {
+                    auto _header = reader.template read<data_header>();
+
+                    if (_header.get_main_type() != d_tuple || _header.length != std::tuple_size_v<_Ty>)
+                        report_error(reader, _header.get_main_type() != d_tuple ? error_code::type_mismatch : error_code::length_mismatch);
+                }
+
+                return construct_tuple_impl<_Ty>(reader, std::make_index_sequence<std::tuple_size_v<_Ty>>{});
+            }
+            else
+            {
+                static_assert(
+                    Always_false<_Ty>,
+                    "_Ty to deserialize must be default constructible, implement deserialize() or a constructor taking (zeus::deserialize_tag_t, reader)");
+            }
+        }
+    }
+
+    /*
+     * Deserialize into an existing object
+     * Containers are cleared and refilled (a std::vector keeps its capacity), members of pairs and tuples and
+     * alternatives of variants are decoded in place
+     */
+    template <class _Ty, class _Reader>
+    void deserialize_object_into(_Reader &reader, _Ty &object)
+    {
+        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be deserialized can not be pointer type");
+
+        _ZPACKER_STATS_SCOPE(_Ty, reader, false);
+
+        /* a single bounds check for the whole object if its size is known at compile time */
+        if constexpr (is_fixed_wire_size_v<_Ty> && has_consume_bytes_v<_Reader> && !std::is_same_v<_Reader, bytes_reader_unchecked>)
+        {
+            if (detail::compact_layout(reader))
+            {
+                auto _data = reader.consume_bytes(static_wire_size_v<_Ty>);
+
+                if (!_data)
+                    return;
+
+                bytes_reader_unchecked _reader{_data, static_wire_size_v<_Ty>};
+
+                deserialize_object_into(_reader, object);
+
+                if (!_reader.good())
+                    detail::report_error(reader, _reader.error());
+
+                return;
+            }
+        }
+
+        /* the static size is a lower bound for the older formats */
+        if constexpr (is_fixed_wire_size_v<_Ty>)
+        {
+            if (reader.remaining() < static_wire_size_v<_Ty>)
+                return detail::report_error(reader, error_code::short_buffer);
+        }
+
+        if constexpr (has_deserialize_v<_Ty>)
+        {
+            object = _Ty::deserialize(reader);
+        }
+        else if constexpr (has_deserialize_constructor_v<_Ty, _Reader>)
+        {
+            object = _Ty(deserialize_tag, reader);
+        }
+        else if constexpr (detail::is_reflectable_v<_Ty>)
+        {
+            detail::read_fields(reader, object);
+        }
+        else if constexpr (is_specialize_of_v<_Ty, std::pair>)
+        {
+            auto _header = reader.template read<data_header>();
+
+            // runtime check
+            if (_header.length != 2 || _header.get_main_type() != d_pair)
+                return detail::report_error(reader, error_code::type_mismatch);
+
+            detail::read_into(reader, object.first);
+            detail::read_into(reader, object.second);
+        }
+        else if constexpr (is_specialize_of_v<_Ty, std::variant>)
+        {
+            using _Variant = _Ty;
+
+            std::uint32_t _index{};
+
+            if (detail::compact_layout(reader))
+            {
+                _index = reader.template read<detail::variant_index_t<_Variant>>();
+            }
+            else
+            {
+                auto _header = reader.template read<data_header>();
+
+                if (_header.get_main_type() != d_variant || _header.length != std::variant_size_v<_Variant>)
+                    return detail::report_error(reader, _header.get_main_type() != d_variant ? error_code::type_mismatch : error_code::length_mismatch);
+
+                _index = reader.template read<uint32_t>();
+            }
+
+            if (_index >= std::variant_size_v<_Variant>)
+                return detail::report_error(reader, error_code::invalid_index);
+
+            detail::deserialize_variant_impl(reader, _index, object, std::make_index_sequence<std::variant_size_v<_Variant>>{});
+        }
+        else if constexpr (is_specialize_of_v<_Ty, std::tuple>)
+        {
+            using _Tuple = _Ty;
+
+            if (!detail::compact_layout(reader))
+            {
+                auto _header = reader.template read<data_header>();
+
+                if (_header.get_main_type() != d_tuple || _header.length != std::tuple_size_v<_Tuple>)
+                    return detail::report_error(reader, _header.get_main_type() != d_tuple ? error_code::type_mismatch : error_code::length_mismatch);
+            }
+
+            detail::deserialize_tuple_impl(reader, object, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
+        }
+        else if constexpr (std::is_same_v<_Ty, std::string> && has_consume_bytes_v<_Reader>)
+        {
+            auto _view = detail::read_string_view(reader);
+
+            _ZPACKER_STATS_ELEMENTS(_Ty, _view.size(), false);
+
+            object.assign(_view.data(), _view.size());
+        }
+        else if constexpr (detail::is_bit_vector_v<_Ty>)
+        {
+            detail::read_bits(reader, reader.template read<data_header>(), object);
+
+            _ZPACKER_STATS_ELEMENTS(_Ty, object.size(), false);
+        }
+        else if constexpr (is_standard_container_v<_Ty>)
+        {
+            using value_type = typename _Ty::value_type;
+
+            auto _header = reader.template read<data_header>();
+
+            bool _ordered = _header.get_main_type() == d_aso_container && _header.take_ordered_flag();
+
+            bool _sparse = detail::take_padding(reader, _header);
+
+            if constexpr (!is_std_array_v<_Ty>)
+                object.clear();
+
+            /* sparse sequences are bounded by their number of blocks */
+            if (_sparse)
+            {
+                if constexpr (detail::is_sparse_encodable_v<_Ty>)
+                {
+                    if (_header.get_sub_type() != get_data_type<value_type>())
+                        return detail::report_error(reader, error_code::type_mismatch);
+
+                    _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, false);
+
+                    return detail::read_sparse(reader, _header.length, object);
+                }
+                else
+                {
+                    return detail::report_error(reader, error_code::type_mismatch);
+                }
+            }
+
+            /* every element takes at least one byte, reject corrupted lengths before looping over them */
+            if (!is_std_array_v<_Ty> && _header.length > reader.remaining() / detail::min_nested_size<value_type>())
+                return detail::report_error(reader, error_code::short_buffer);
+
+            _ZPACKER_STATS_ELEMENTS(_Ty, _header.length, false);
+
+            if constexpr (is_std_array_v<_Ty>)
+            {
+                detail::read_array_elements(reader, _header, object.data(), object.size());
+            }
+            else if constexpr (is_sequence_container_v<_Ty>)
+            {
+                // runtime check
+                if (_header.get_main_type() != d_seq_container ||
+                    !_header.template is_subtype_compitable<value_type>())
+                    return detail::report_error(reader, error_code::type_mismatch);
+
+                /* elements stored as they are come in with one copy, the length was checked against the buffer */
+                if constexpr (has_data_v<_Ty> && has_resize_v<_Ty> && detail::is_raw_v<value_type> &&
+                              std::is_default_constructible_v<value_type>)
+                {
+                    if (_header.get_sub_type() == get_data_type<value_type>())
+                    {
+                        object.resize(_header.length);
+
+                        detail::read_raw(reader, object.data(), sizeof(value_type) * _header.length);
+
+                        return;
+                    }
+                }
+
+                if constexpr (has_reserve_v<_Ty>)
+                    object.reserve(detail::reserve_count<value_type>(_header.length));
+
+                for (std::uint32_t i = 0; i < _header.length; i++)
+                    detail::emplace_element(reader, object);
+            }
+            else if constexpr (is_associated_container_v<_Ty>)
+            {
+                // runtime check
+                if (_header.get_main_type() != d_aso_container ||
+                    !_header.template is_subtype_compitable<value_type>())
+                    return detail::report_error(reader, error_code::type_mismatch);
+
+                /* std::unordered_* allocate the buckets once */
+                if constexpr (has_reserve_v<_Ty>)
+                    object.reserve(detail::reserve_count<value_type>(_header.length));
+
+                /* the hint only pays off when the target orders its elements like the source did */
+                if constexpr (has_key_compare_v<_Ty>)
+                {
+                    if (_ordered)
+                    {
+                        for (std::uint32_t i = 0; i < _header.length; i++)
+                            detail::emplace_element<true>(reader, object);
+
+                        return;
+                    }
+                }
+
+                for (std::uint32_t i = 0; i < _header.length; i++)
+                    detail::emplace_element(reader, object);
+            }
+        }
+        else if constexpr (detail::is_raw_v<_Ty>)
+        {
+            if constexpr (std::is_compound_v<_Ty>)
+            {
+                auto _header = reader.template read<data_header>();
+
+                // runtime check
+                if (_header.length < sizeof(_Ty))
+                    return detail::report_error(reader, error_code::length_mismatch);
+            }
+
+            object = reader.template read<_Ty>();
+        }
+        else
+        {
+            static_assert(
+                Always_false<_Ty>,
+                "_Ty to deserialize must be either of a standard STL container type, custom containers that implement standard iterator, "
+                "POD type, arithmetic type or custom types that implement deserialize() method");
+        }
+    }
+
+    /*
+     * Deserialize a object from binary format
+     *
+     * Default constructible types are decoded in place into the returned object, custom types are built by their
+     * `deserialize` method or their `(zeus::deserialize_tag_t, reader)` constructor, pairs and tuples of types that
+     * are not default constructible from their decoded members
+     */
+    template <
+        class _Ty,
+        class _Reader = bytes_reader,
+        std::enable_if_t<detail::is_deserializable_v<_Ty, _Reader>, int> = 0>
+    _Ty deserialize_object(_Reader &reader)
+    {
+        if constexpr (detail::is_constructed_on_read_v<_Ty, _Reader>)
+        {
+            return detail::construct_object<_Ty>(reader);
+        }
+        else
+        {
+            _Ty object{};
+
+            deserialize_object_into(reader, object);
+
+            return object;
+        }
+    }
+
+    namespace detail
+    {
+        /* append a packer header and whatever `write` writes behind it to `buffer`, cut `buffer` back on failure */
+        template <class _Buffer, class _CheckSum, class _Write>
+        error_code pack_into(_Buffer &buffer, _CheckSum checksum, _Write &&write)
+        {
+            const auto _start = static_cast<std::size_t>(buffer.size());
+
+            basic_bytes_writer<_Buffer> writer{buffer};
+
+            /* patched below once the payload is known */
+            writer.reserve_bytes(sizeof(packer_header));
+
+            write(writer);
+
+            if (!writer.good())
+            {
+                buffer.resize(_start);
+                return writer.error();
+            }
+
+            auto _data = reinterpret_cast<std::uint8_t *>(buffer.data()) + _start;
+
+            const auto payload_size = buffer.size() - _start - sizeof(packer_header);
+
+            packer_header ph{};
+
+            ph.set_version(VERSION);
+
+            ph.crc.crc32 = checksum(_data + sizeof(packer_header), payload_size);
+
+            ph.length = static_cast<std::uint32_t>(payload_size);
+
+            memcpy(_data, &ph, sizeof(ph));
+
+            return error_code::none;
+        }
+
+        /* `pack_into` a new vector, empty on failure */
+        template <class _CheckSum, class _Write>
+        std::vector<std::uint8_t> pack(_CheckSum checksum, _Write &&write)
+        {
+            std::vector<std::uint8_t> result{};
+
+            result.reserve(_default_reserve_size);
+
+            pack_into(result, checksum, std::forward<_Write>(write));
+
+            return result;
+        }
+    }
+
+    /*
+     * Append a object packed like `serialize`, packer header included, to a buffer of the caller: anything
+     * `basic_bytes_writer` writes to, e.g. std::string, std::pmr::vector<std::byte> or a `callback_buffer`
+     *
+     * The bytes are encoded in place, nothing is copied afterwards. On failure the buffer is cut back to its former
+     * size and the error is returned.
+     */
+    template <
+        class _Buffer,
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code serialize_into(_Buffer &buffer, const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        return detail::pack_into(buffer, checksum, [&value](auto &writer)
+        {
+            serialize_object(writer, value);
+        });
+    }
+
+    /*
+     * Pack a object behind a packer header
+     * An empty vector is returned if the object reports an error while it is written, `serialize_into` returns it
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize(const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        if constexpr (is_fixed_wire_size_v<_Ty>)
+        {
+            /* the size is known up front, encode straight behind the packer header */
+            std::vector<std::uint8_t> result(sizeof(packer_header) + static_wire_size_v<_Ty>);
+
+            bytes_writer_bounded writer{result.data() + sizeof(packer_header), static_wire_size_v<_Ty>};
+
+            serialize_object(writer, value);
+
+            packer_header ph{};
+
+            ph.set_version(VERSION);
+
+            ph.crc.crc32 = checksum(result.data() + sizeof(packer_header), static_wire_size_v<_Ty>);
+
+            ph.length = static_cast<std::uint32_t>(static_wire_size_v<_Ty>);
+
+            memcpy(result.data(), &ph, sizeof(ph));
+
+            return result;
+        }
+
+        std::vector<std::uint8_t> result{};
+
+        result.reserve(_default_reserve_size);
+
+        serialize_into(result, value, checksum);
+
+        result.shrink_to_fit();
+
+        return result;
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize(
+        const void *buffer,
+        size_t bufsize,
+        const _Ty &value,
+        _CheckSum checksum = empty_checksum{})
+    {
+        std::vector<std::uint8_t> result{};
+
+        if constexpr (is_fixed_wire_size_v<_Ty>)
+        {
+            if (bufsize < static_wire_size_v<_Ty>)
+                return result;
+        }
+
+        bytes_writer_bounded writer{(uint8_t *)buffer, bufsize};
+
+        // serialization
+        serialize_object(writer, value);
+
+        if (!writer.good())
+            return result;
+
+        auto length = writer.count();
+
+        result.reserve(writer.count() + sizeof(packer_header));
+
+        // insert packer header
+        packer_header ph{};
+
+        ph.set_version(VERSION);
+
+        ph.crc.crc32 = checksum((uint8_t *)buffer, length);
+
+        ph.length = static_cast<std::uint32_t>(length);
+
+        bytes_writer data_writer{result};
+
+        data_writer << ph;
+        data_writer.write((uint8_t *)buffer, length);
+
+        result.shrink_to_fit();
+
+        return result;
+    }
+
+    /*
+     * Serialize a object like `serialize` into a buffer holding up to `_Size` bytes inline, e.g.
+     * `zeus::serialize<256>(message)`: messages that fit, packer header included, are not allocated
+     */
+    template <
+        std::size_t _Size,
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    small_buffer<_Size> serialize(const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        small_buffer<_Size> result{};
+
+        serialize_into(result, value, checksum);
+
+        return result;
+    }
+
+    /*
+     * Serialize a object like `serialize`, arrays of trivially copyable elements are padded to their alignment
+     *
+     * The payload is written behind the packer header in the same buffer: the padding holds relative to the start of
+     * the returned buffer, and to the memory it is copied or mapped to if that is aligned to 64 bytes.
+     * `read_array_view` then hands out the elements in place.
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_aligned(const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        return detail::pack(checksum, [&value](bytes_writer &writer)
+        {
+            writer.set_aligned(true);
+
+            serialize_object(writer, value);
+        });
+    }
+
+    /*
+     * Serialize a object like `serialize`, vectors of integers and floating point numbers that are mostly zero or
+     * repetitive are stored in sparse or run-length blocks, see `format_state::set_sparse`
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_sparse(const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        return detail::pack(checksum, [&value](bytes_writer &writer)
+        {
+            writer.set_sparse(true);
+
+            serialize_object(writer, value);
+        });
+    }
+
+    /*
+     * Serialize a object like `serialize_sparse`, vectors of float and double that change slowly are also stored as
+     * the XOR of every element with the one before it, see `format_state::set_xor_floats`
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_xor_floats(const _Ty &value, _CheckSum checksum = empty_checksum{})
+    {
+        return detail::pack(checksum, [&value](bytes_writer &writer)
+        {
+            writer.set_sparse(true);
+            writer.set_xor_floats(true);
+
+            serialize_object(writer, value);
+        });
+    }
+
+    /*
+     * Trivially copyable elements of an array left in the buffer, see `read_array_view`
+     */
+    template <class _Ty>
+    class array_view
+    {
+    public:
+        array_view() = default;
+
+        array_view(const _Ty *data, std::size_t size) : m_data(data), m_size(size) {}
+
+        const _Ty *data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        const _Ty &operator[](std::size_t index) const
+        {
+            return m_data[index];
+        }
+
+        const _Ty *begin() const
+        {
+            return m_data;
+        }
+
+        const _Ty *end() const
+        {
+            return m_data + m_size;
+        }
+
+    private:
+        const _Ty *m_data{nullptr};
+        std::size_t m_size{0};
+    };
+
+    /*
+     * Hand out the elements of a sequence of `_Ty` at the reader position without copying them
+     *
+     * The elements stay in the buffer, which must outlive the view. They are aligned if the sequence was written with
+     * `set_aligned` (see `serialize_aligned`) and the buffer is aligned like the writer's one, otherwise
+     * `error_code::misaligned` is reported and the elements have to be decoded.
+     */
+    template <
+        class _Ty,
+        class _Reader,
+        std::enable_if_t<detail::is_raw_v<_Ty> && has_consume_bytes_v<_Reader>, int> = 0>
+    array_view<_Ty> read_array_view(_Reader &reader)
+    {
+        auto _header = reader.template read<data_header>();
+
+        if (!reader.good())
+            return {};
+
+        /* sparse sequences have to be expanded, see `deserialize_object_into` */
+        if (detail::take_padding(reader, _header) || _header.get_main_type() != d_seq_container ||
+            get_data_type<_Ty>() != _header.get_sub_type())
+        {
+            detail::report_error(reader, error_code::type_mismatch);
+            return {};
+        }
+
+        if (_header.length > reader.remaining() / sizeof(_Ty))
+        {
+            detail::report_error(reader, error_code::short_buffer);
+            return {};
+        }
+
+        auto _data = reader.consume_bytes(sizeof(_Ty) * _header.length);
+
+        if (!_data)
+            return {};
+
+        if (reinterpret_cast<std::uintptr_t>(_data) % alignof(_Ty) != 0)
+        {
+            detail::report_error(reader, error_code::misaligned);
+            return {};
+        }
+
+        return {reinterpret_cast<const _Ty *>(_data), _header.length};
+    }
+
+    namespace detail
+    {
+        /*
+         * Check the packer header in front of the payload, the payload can only be trusted if `error_code::none` is returned
+         */
+        inline std::uint16_t packer_version(const std::uint8_t *data)
+        {
+            std::uint16_t version;
+
+            memcpy(&version, data, sizeof(version));
+
+            return version;
+        }
+
+        template <class _CheckSum>
+        error_code check_packer_header(const std::uint8_t *data, std::size_t length, _CheckSum &checksum)
+        {
+            if (length < sizeof(packer_header))
+                return error_code::short_buffer;
+
+            packer_header ph{};
+
+            memcpy(&ph, data, sizeof(ph));
+
+            // check header, data packed by an older format version is still accepted
+            if (ph.version < VERSION_OLDEST || ph.version > VERSION)
+                return error_code::version_mismatch;
+
+            if (ph.length > length - sizeof(packer_header))
+                return error_code::short_buffer;
+
+            // check checksum
+            std::uint32_t crc = checksum(data + sizeof(packer_header), ph.length);
+            if (crc != ph.crc.crc32)
+                return error_code::checksum_mismatch;
+
+            return error_code::none;
+        }
+    }
+
+    /*
+     * Outcome of `try_deserialize`, either the object or the reason and the byte offset of the failure
+     * Accessing the object of a failed result is undefined, check `has_value()` first
+     */
+    template <class _Ty>
+    class deserialize_result
+    {
+    public:
+        deserialize_result(_Ty &&value) : m_value(std::move(value)) {}
+
+        deserialize_result(error_code code, std::size_t offset) : m_error(code), m_error_offset(offset) {}
+
+        bool has_value() const
+        {
+            return m_value.has_value();
+        }
+
+        explicit operator bool() const
+        {
+            return has_value();
+        }
+
+        _Ty &value() &
+        {
+            return *m_value;
+        }
+
+        const _Ty &value() const &
+        {
+            return *m_value;
+        }
+
+        _Ty &&value() &&
+        {
+            return std::move(*m_value);
+        }
+
+        _Ty &operator*() &
+        {
+            return *m_value;
+        }
+
+        const _Ty &operator*() const &
+        {
+            return *m_value;
+        }
+
+        _Ty *operator->()
+        {
+            return std::addressof(*m_value);
+        }
+
+        const _Ty *operator->() const
+        {
+            return std::addressof(*m_value);
+        }
+
+        error_code error() const
+        {
+            return m_error;
+        }
+
+        /*
+         * Offset of the failure from the beginning of the packed data
+         */
+        std::size_t error_offset() const
+        {
+            return m_error_offset;
+        }
+
+    private:
+        std::optional<_Ty> m_value{};
+        error_code m_error{error_code::none};
+        std::size_t m_error_offset{0};
+    };
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
+    _Ty deserialize(const std::vector<std::uint8_t> &data, _CheckSum checksum = empty_checksum{})
+    {
+        if (detail::check_packer_header(data.data(), data.size(), checksum) != error_code::none)
+            return _Ty{};
+
+        bytes_reader reader{data};
+
+        reader.set_format(detail::packer_version(data.data()));
+
+        reader.skip(sizeof(packer_header));
+
+        // perform deserialize
+        return deserialize_object<_Ty>(reader);
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
+    _Ty deserialize(
+        const void *buffer,
+        size_t length,
+        _CheckSum checksum = empty_checksum{})
+    {
+        if (detail::check_packer_header((const std::uint8_t *)buffer, length, checksum) != error_code::none)
+            return _Ty{};
+
+        bytes_reader_bounded reader{(const std::uint8_t *)buffer, length};
+
+        reader.set_format(detail::packer_version((const std::uint8_t *)buffer));
+
+        reader.skip(sizeof(packer_header));
+
+        // perform deserialize
+        return deserialize_object<_Ty>(reader);
+    }
+
+    /*
+     * Same as `deserialize` but tells a failure apart from an empty object
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<detail::is_deserializable_v<_Ty, bytes_reader>, int> = 0>
+    deserialize_result<_Ty> try_deserialize(const std::vector<std::uint8_t> &data, _CheckSum checksum = empty_checksum{})
+    {
+        auto code = detail::check_packer_header(data.data(), data.size(), checksum);
+
+        if (code != error_code::none)
+            return {code, 0};
+
+        bytes_reader reader{data};
+
+        reader.set_format(detail::packer_version(data.data()));
+
+        reader.skip(sizeof(packer_header));
+
+        auto object = deserialize_object<_Ty>(reader);
+
+        if (!reader.good())
+            return {reader.error(), reader.error_offset()};
+
+        return object;
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<detail::is_deserializable_v<_Ty, bytes_reader_bounded>, int> = 0>
+    deserialize_result<_Ty> try_deserialize(
+        const void *buffer,
+        size_t length,
+        _CheckSum checksum = empty_checksum{})
+    {
+        auto code = detail::check_packer_header((const std::uint8_t *)buffer, length, checksum);
+
+        if (code != error_code::none)
+            return {code, 0};
+
+        bytes_reader_bounded reader{(const std::uint8_t *)buffer, length};
+
+        reader.set_format(detail::packer_version((const std::uint8_t *)buffer));
+
+        reader.skip(sizeof(packer_header));
+
+        auto object = deserialize_object<_Ty>(reader);
+
+        if (!reader.good())
+            return {reader.error(), reader.error_offset()};
+
+        return object;
+    }
+
+    namespace detail
+    {
+        /*
+         * Split [0, count) into `concurrency` contiguous slices and run `fn(begin, end)` on each
+         * The calling thread always processes the first slice
+         */
+        inline std::size_t slice_length(std::size_t count, std::size_t concurrency)
+        {
+            concurrency = (std::max)((std::min)(concurrency, count), (std::size_t)1);
+
+            return (std::max)((count + concurrency - 1) / concurrency, (std::size_t)1);
+        }
+
+        template <class _Fn>
+        void parallel_slices(std::size_t count, std::size_t concurrency, _Fn &&fn)
+        {
+            auto slice = slice_length(count, concurrency);
+
+            if (slice >= count)
+            {
+                fn((std::size_t)0, count);
+                return;
+            }
+
+            std::vector<std::thread> workers;
+
+            workers.reserve(count / slice);
+
+            for (std::size_t begin = slice; begin < count; begin += slice)
+            {
+                auto end = (std::min)(begin + slice, count);
+
+                workers.emplace_back([&fn, begin, end]()
+                                     { fn(begin, end); });
+            }
+
+            fn((std::size_t)0, (std::min)(slice, count));
+
+            std::for_each(workers.begin(), workers.end(), [](auto &t)
+                          { t.join(); });
+        }
+
+        inline void store_u32(std::uint8_t *data, std::uint32_t value)
+        {
+            memcpy(data, &value, sizeof(value));
+        }
+
+        inline std::uint32_t load_u32(const std::uint8_t *data)
+        {
+            std::uint32_t value;
+
+            memcpy(&value, data, sizeof(value));
+
+            return value;
+        }
+    }
+
+    /*
+     * Serialize a range of independent objects into one contiguous arena
+     *
+     * layout: packer_header | uint32 count | uint32 offsets[count + 1] | messages
+     * offsets are relative to the first message, message `i` occupies [offsets[i], offsets[i + 1])
+     * the checksum covers everything after the packer header
+     *
+     * `concurrency` > 1 fans the encoding out across threads, each thread encodes a slice of the
+     * range into its own buffer which are then stitched into the arena
+     *
+     * An empty vector is returned if any object reports an error or the arena outgrows uint32 offsets
+     */
+    template <
+        class _Iter,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_batch(
+        _Iter first,
+        _Iter last,
+        _CheckSum checksum = empty_checksum{},
+        std::size_t concurrency = 1)
+    {
+        const auto count = static_cast<std::size_t>(std::distance(first, last));
+
+        /* the count, the offsets and the packer header length are all uint32 */
+        constexpr std::size_t max_length = (std::numeric_limits<std::uint32_t>::max)();
+
+        if (count >= max_length / sizeof(std::uint32_t))
+            return {};
+
+        const std::size_t table_pos = sizeof(packer_header) + sizeof(std::uint32_t);
+        const std::size_t data_pos = table_pos + sizeof(std::uint32_t) * (count + 1);
+
+        std::vector<std::uint8_t> result(data_pos);
+
+        detail::store_u32(result.data() + sizeof(packer_header), static_cast<std::uint32_t>(count));
+
+        if (concurrency <= 1 || count < 2)
+        {
+            result.reserve((std::max)(data_pos * 2, _default_reserve_size));
+
+            bytes_writer writer{result};
+
+            for (std::size_t i = 0; i < count; ++i, ++first)
+            {
+                detail::store_u32(result.data() + table_pos + i * sizeof(std::uint32_t), static_cast<std::uint32_t>(result.size() - data_pos));
+
+                serialize_object(writer, *first);
+
+                if (!writer.good())
+                    return {};
+            }
+        }
+        else
+        {
+            auto slice_len = detail::slice_length(count, concurrency);
+
+            std::vector<std::vector<std::uint8_t>> slices((count + slice_len - 1) / slice_len);
+            std::vector<std::uint32_t> offsets(count);
+
+            /* a byte per slice, each one is written by its own thread */
+            std::vector<std::uint8_t> failed(slices.size());
+
+            detail::parallel_slices(count, concurrency, [&](std::size_t begin, std::size_t end)
+                                    {
+                auto &buffer = slices[begin / slice_len];
+
+                buffer.reserve(_default_reserve_size);
+
+                bytes_writer writer{buffer};
+
+                auto it = std::next(first, static_cast<typename std::iterator_traits<_Iter>::difference_type>(begin));
+
+                for (auto i = begin; i < end; ++i, ++it)
+                {
+                    offsets[i] = static_cast<std::uint32_t>(buffer.size());
+
+                    serialize_object(writer, *it);
+
+                    if (!writer.good())
+                    {
+                        failed[begin / slice_len] = 1;
+                        return;
+                    }
+                } });
+
+            if (std::find(failed.begin(), failed.end(), std::uint8_t{1}) != failed.end())
+                return {};
+
+            std::size_t total = std::accumulate(slices.begin(), slices.end(), (std::size_t)0, [](std::size_t n, const auto &s)
+                                                { return n + s.size(); });
+
+            if (total > max_length - (data_pos - sizeof(packer_header)))
+                return {};
+
+            result.reserve(data_pos + total);
+
+            // rebase the slice local offsets onto the arena
+            std::size_t base = 0;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (i != 0 && i % slice_len == 0)
+                    base += slices[i / slice_len - 1].size();
+
+                detail::store_u32(result.data() + table_pos + i * sizeof(std::uint32_t), static_cast<std::uint32_t>(base + offsets[i]));
+            }
+
+            std::for_each(slices.begin(), slices.end(), [&result](const auto &s)
+                          { result.insert(result.end(), s.begin(), s.end()); });
+        }
+
+        /* offsets are below the payload length, checking the latter covers them all */
+        if (result.size() - sizeof(packer_header) > max_length)
+            return {};
+
+        detail::store_u32(result.data() + table_pos + count * sizeof(std::uint32_t), static_cast<std::uint32_t>(result.size() - data_pos));
+
+        // insert packer header in place
+        packer_header ph{};
+
+        ph.set_version(VERSION);
+
+        ph.length = static_cast<std::uint32_t>(result.size() - sizeof(packer_header));
+
+        ph.crc.crc32 = checksum(result.data() + sizeof(packer_header), ph.length);
+
+        memcpy(result.data(), &ph, sizeof(ph));
+
+        return result;
+    }
+
+    template <
+        class _Container,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_batch(
+        const _Container &objects,
+        _CheckSum checksum = empty_checksum{},
+        std::size_t concurrency = 1)
+    {
+        return serialize_batch(objects.begin(), objects.end(), checksum, concurrency);
+    }
+
+    /*
+     * Deserialize all messages of a batch produced by `serialize_batch`
+     * An empty vector is returned if the batch is malformed or any of its messages fails to decode
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
+    std::vector<_Ty> deserialize_batch(
+        const void *buffer,
+        std::size_t length,
+        _CheckSum checksum = empty_checksum{},
+        std::size_t concurrency = 1)
+    {
+        auto data = static_cast<const std::uint8_t *>(buffer);
+
+        if (detail::check_packer_header(data, length, checksum) != error_code::none)
+            return {};
+
+        packer_header ph{};
+
+        memcpy(&ph, data, sizeof(ph));
+
+        if (ph.length < sizeof(std::uint32_t))
+            return {};
+
+        auto payload = data + sizeof(packer_header);
+        auto count = static_cast<std::size_t>(detail::load_u32(payload));
+
+        auto table = payload + sizeof(std::uint32_t);
+
+        if ((ph.length - sizeof(std::uint32_t)) / sizeof(std::uint32_t) < count + 1)
+            return {};
+
+        auto messages = table + sizeof(std::uint32_t) * (count + 1);
+        auto messages_length = static_cast<std::size_t>(payload + ph.length - messages);
+
+        if (detail::load_u32(table + count * sizeof(std::uint32_t)) != messages_length)
+            return {};
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (detail::load_u32(table + i * sizeof(std::uint32_t)) > detail::load_u32(table + (i + 1) * sizeof(std::uint32_t)))
+                return {};
+        }
+
+        std::vector<_Ty> result(count);
+        std::atomic<bool> failed{false};
+
+        detail::parallel_slices(count, concurrency, [&](std::size_t begin, std::size_t end)
+                                {
+            bytes_reader_bounded reader{messages, 0};
+
+            reader.set_format(ph.version);
+
+            for (auto i = begin; i < end && !failed.load(std::memory_order_relaxed); ++i)
+            {
+                auto from = detail::load_u32(table + i * sizeof(std::uint32_t));
+                auto to = detail::load_u32(table + (i + 1) * sizeof(std::uint32_t));
+
+                reader.reset(messages + from, to - from);
+
+                result[i] = deserialize_object<_Ty>(reader);
+
+                /* a message must decode cleanly and fill its whole slot */
+                if (!reader.good() || reader.remaining() != 0)
+                    failed.store(true, std::memory_order_relaxed);
+            } });
+
+        if (failed.load())
+            return {};
+
+        return result;
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
+    std::vector<_Ty> deserialize_batch(
+        const std::vector<std::uint8_t> &data,
+        _CheckSum checksum = empty_checksum{},
+        std::size_t concurrency = 1)
+    {
+        return deserialize_batch<_Ty>(data.data(), data.size(), checksum, concurrency);
+    }
+
+    /*
+     * Name of a data type, for diagnostics
+     */
+    constexpr const char *data_type_name(data_type dt)
+    {
+        constexpr const char *_names[] = {
+            "empty", "byte8", "byte16", "byte32", "byte64", "float32", "float64",
+            "pod", "pair", "variant", "tuple", "seq_container", "aso_container", "custom", "record", "string_ref"};
+
+        return static_cast<std::size_t>(dt) < std::size(_names) ? _names[dt] : "unknown";
+    }
+
+    namespace detail
+    {
+        /* skip `count` elements of scalar type `dt` in O(1) */
+        template <class _Reader>
+        void skip_scalars(_Reader &reader, data_type dt, std::size_t count)
+        {
+            auto size = scalar_wire_size(dt);
+
+            if (count > reader.remaining() / size)
+                reader.set_error(error_code::short_buffer);
+            else
+                reader.skip(size * count);
+        }
+
+        template <class _Ty>
+        constexpr bool is_headerless_nested_impl();
+
+        template <class _Tuple, size_t... _Indices>
+        constexpr bool is_headerless_tuple_impl(std::index_sequence<_Indices...>)
+        {
+            return (is_headerless_nested_impl<std::tuple_element_t<_Indices, _Tuple>>() && ...);
+        }
+
+        /*
+         * Values of the compact layout made of raw bytes only: no header, variant index or length in them can be
+         * checked, so they are skipped in O(1)
+         */
+        template <class _Ty>
+        constexpr bool is_headerless_impl()
+        {
+            if constexpr (is_specialize_of_v<_Ty, std::tuple>)
+                return is_headerless_tuple_impl<_Ty>(std::make_index_sequence<std::tuple_size_v<_Ty>>{});
+            else if constexpr (is_reflectable_v<_Ty>)
+                return is_headerless_tuple_impl<field_types_t<_Ty>>(std::make_index_sequence<std::tuple_size_v<field_types_t<_Ty>>>{});
+            else if constexpr (is_raw_v<_Ty> && !has_serialize_v<_Ty> && !has_deserialize_v<_Ty>)
+                return !std::is_compound_v<_Ty>;
+            else
+                return false;
+        }
+
+        /* nested raw values are stored without a header */
+        template <class _Ty>
+        constexpr bool is_headerless_nested_impl()
+        {
+            if constexpr (is_raw_v<_Ty> && !has_serialize_v<_Ty> && !has_deserialize_v<_Ty>)
+                return true;
+            else
+                return is_headerless_impl<_Ty>();
+        }
+
+        template <class _Ty, class _Reader>
+        void skip_nested(_Reader &reader);
+
+        template <class _Variant, class _Reader, size_t... _Indices>
+        void skip_variant_impl(_Reader &reader, std::uint32_t index, std::index_sequence<_Indices...>)
+        {
+            using _Variant_skipper_t = void (*)(_Reader &);
+
+            constexpr _Variant_skipper_t _table[] = {&skip_nested<std::variant_alternative_t<_Indices, _Variant>, _Reader>...};
+
+            _table[index](reader);
+        }
+
+        template <class _Tuple, class _Reader, size_t... _Indices>
+        void skip_tuple_impl(_Reader &reader, std::index_sequence<_Indices...>)
+        {
+            (skip_nested<std::tuple_element_t<_Indices, _Tuple>>(reader), ...);
+        }
+    }
+
+    /*
+     * Skip over an encoded `_Ty` without constructing it
+     *
+     * Containers of scalars and fixed-size values without headers are skipped in O(1), headers of containers, pairs,
+     * tuples and variants are checked on the way. Custom types do not describe their extent, they are decoded and dropped.
+     * Failures are reported through the error state of the reader.
+     */
+    template <class _Ty, class _Reader>
+    void skip_object(_Reader &reader)
+    {
+        using _Vty = remove_cvref_t<_Ty>;
+
+        if constexpr (is_fixed_wire_size_v<_Vty> && detail::is_headerless_impl<_Vty>())
+        {
+            if (detail::compact_layout(reader))
+                return reader.skip(static_wire_size_v<_Vty>);
+        }
+
+        if constexpr (has_deserialize_v<_Vty>)
+        {
+            (void)deserialize_object<_Vty>(reader);
+        }
+        else if constexpr (detail::is_reflectable_v<_Vty>)
+        {
+            using _Fields = detail::field_types_t<_Vty>;
+
+            detail::skip_tuple_impl<_Fields>(reader, std::make_index_sequence<std::tuple_size_v<_Fields>>{});
+        }
+        else if constexpr (is_specialize_of_v<_Vty, std::pair>)
+        {
+            auto _header = reader.template read<data_header>();
+
+            if (_header.length != 2 || _header.get_main_type() != d_pair)
+                return reader.set_error(error_code::type_mismatch);
+
+            detail::skip_nested<typename _Vty::first_type>(reader);
+            detail::skip_nested<typename _Vty::second_type>(reader);
+        }
+        else if constexpr (is_specialize_of_v<_Vty, std::variant>)
+        {
+            std::uint32_t _index{};
+
+            if (detail::compact_layout(reader))
+            {
+                _index = reader.template read<detail::variant_index_t<_Vty>>();
+            }
+            else
+            {
+                auto _header = reader.template read<data_header>();
+
+                if (_header.get_main_type() != d_variant || _header.length != std::variant_size_v<_Vty>)
+                    return reader.set_error(error_code::type_mismatch);
+
+                _index = reader.template read<std::uint32_t>();
+            }
+
+            if (_index >= std::variant_size_v<_Vty>)
+                return reader.set_error(error_code::invalid_index);
+
+            detail::skip_variant_impl<_Vty>(reader, _index, std::make_index_sequence<std::variant_size_v<_Vty>>{});
+        }
+        else if constexpr (is_specialize_of_v<_Vty, std::tuple>)
+        {
+            if (!detail::compact_layout(reader))
+            {
+                auto _header = reader.template read<data_header>();
+
+                if (_header.get_main_type() != d_tuple || _header.length != std::tuple_size_v<_Vty>)
+                    return reader.set_error(error_code::type_mismatch);
+            }
+
+            detail::skip_tuple_impl<_Vty>(reader, std::make_index_sequence<std::tuple_size_v<_Vty>>{});
+        }
+        else if constexpr (std::is_array_v<_Vty>)
+        {
+            using value_type = std::remove_extent_t<_Vty>;
+
+            auto _header = reader.template read<data_header>();
+
+            if (_header.get_main_type() != d_seq_container || !_header.template is_subtype_compitable<value_type>())
+                return reader.set_error(error_code::type_mismatch);
+
+            if (_header.length != std::extent_v<_Vty>)
+                return reader.set_error(error_code::length_mismatch);
+
+            for (std::size_t i = 0; i < std::extent_v<_Vty> && reader.good(); i++)
+                detail::skip_nested<value_type>(reader);
+        }
+        else if constexpr (std::is_same_v<_Vty, std::string> && has_consume_bytes_v<_Reader>)
+        {
+            /* the string table of the reader has to see every string */
+            (void)detail::read_string_view(reader);
+        }
+        else if constexpr (detail::is_bit_vector_v<_Vty>)
+        {
+            auto _header = reader.template read<data_header>();
+
+            if (_header.get_main_type() != d_seq_container || (_header.get_sub_type() != d_bits && _header.get_sub_type() != d_byte8))
+                return reader.set_error(error_code::type_mismatch);
+
+            detail::skip_scalars(reader, d_byte8, _header.get_sub_type() == d_bits ? detail::packed_bits_size(_header.length) : _header.length);
+        }
+        else if constexpr (is_standard_container_v<_Vty> || (has_iterator_v<_Vty> && has_value_type_v<_Vty>))
+        {
+            using value_type = typename _Vty::value_type;
+
+            auto _header = reader.template read<data_header>();
+
+            if (!reader.good())
+                return;
+
+            if (_header.get_main_type() == d_aso_container)
+                _header.take_ordered_flag();
+
+            bool _sparse = detail::take_padding(reader, _header);
+
+            if ((_header.get_main_type() != d_seq_container && _header.get_main_type() != d_aso_container) ||
+                !_header.template is_subtype_compitable<value_type>())
+                return reader.set_error(error_code::type_mismatch);
+
+            if constexpr (is_std_array_v<_Vty>)
+            {
+                if (_header.length != std::tuple_size_v<_Vty>)
+                    return reader.set_error(error_code::length_mismatch);
+            }
+
+            if (_sparse)
+                return detail::skip_sparse(reader, _header.get_sub_type(), _header.length);
+
+            /* the wire sub type tells the element size, it may be wider than `value_type` */
+            if (detail::scalar_wire_size(_header.get_sub_type()) != 0)
+                return detail::skip_scalars(reader, _header.get_sub_type(), _header.length);
+
+            if (_header.length > reader.remaining() / detail::min_nested_size<value_type>())
+                return reader.set_error(error_code::short_buffer);
+
+            for (std::uint32_t i = 0; i < _header.length && reader.good(); i++)
+                detail::skip_nested<value_type>(reader);
+        }
+        else if constexpr (detail::is_raw_v<_Vty>)
+        {
+            if constexpr (std::is_compound_v<_Vty>)
+            {
+                auto _header = reader.template read<data_header>();
+
+                if (_header.get_main_type() != d_pod)
+                    return reader.set_error(error_code::type_mismatch);
+
+                if (_header.length < sizeof(_Vty))
+                    return reader.set_error(error_code::length_mismatch);
+            }
+
+            reader.skip(sizeof(_Vty));
+        }
+        else
+        {
+            static_assert(Always_false<_Ty>, "_Ty can not be skipped, see deserialize_object for the supported types");
+        }
+    }
+
+    namespace detail
+    {
+        /* skip `_Ty` nested in another object, i.e. read by `reader >> value` */
+        template <class _Ty, class _Reader>
+        void skip_nested(_Reader &reader)
+        {
+            if constexpr (is_raw_v<_Ty>)
+                reader.skip(sizeof(_Ty));
+            else
+                skip_object<_Ty>(reader);
+        }
+
+        template <class _Reader>
+        void skip_record_fields(_Reader &reader, std::size_t count);
+
+        template <class _Visitor>
+        void walk_value(bytes_reader_bounded &reader, _Visitor &visitor, std::size_t depth);
+
+        template <class _Visitor>
+        void walk_elements(bytes_reader_bounded &reader, _Visitor &visitor, std::size_t depth, data_type dt, std::size_t count)
+        {
+            if (scalar_wire_size(dt) != 0)
+                return skip_scalars(reader, dt, count);
+
+            if (dt == d_bits)
+                return skip_scalars(reader, d_byte8, packed_bits_size(count));
+
+            /* variants of the compact layout do not start with a header */
+            if (dt == d_variant && compact_layout(reader))
+                return reader.set_error(error_code::opaque_value);
+
+            switch (dt)
+            {
+            case d_seq_container:
+            case d_aso_container:
+            case d_variant:
+                if (count > reader.remaining() / sizeof(data_header))
+                    return reader.set_error(error_code::short_buffer);
+
+                for (std::size_t i = 0; i < count && reader.good(); ++i)
+                    walk_value(reader, visitor, depth);
+
+                break;
+
+            default:
+                reader.set_error(error_code::opaque_value);
+            }
+        }
+
+        template <class _Visitor>
+        void walk_value(bytes_reader_bounded &reader, _Visitor &visitor, std::size_t depth)
+        {
+            auto offset = reader.count();
+            auto header = reader.read<data_header>();
+
+            if (!reader.good())
+                return;
+
+            if (header.get_main_type() == d_aso_container)
+                header.take_ordered_flag();
+
+            bool sparse = take_padding(reader, header);
+
+            visitor(offset, depth, header);
+
+            if (sparse)
+                return skip_sparse(reader, header.get_sub_type(), header.length);
+
+            switch (header.get_main_type())
+            {
+            case d_seq_container:
+            case d_aso_container:
+                walk_elements(reader, visitor, depth + 1, header.get_sub_type(), header.length);
+                break;
+
+            case d_variant:
+                if (compact_layout(reader))
+                    return reader.set_error(error_code::opaque_value);
+
+                if (reader.read<std::uint32_t>() >= header.length)
+                    return reader.set_error(error_code::invalid_index);
+
+                walk_elements(reader, visitor, depth + 1, header.get_sub_type(), 1);
+                break;
+
+            case d_record:
+                skip_record_fields(reader, header.length);
+                break;
+
+            case d_string_ref:
+                break;
+
+            default:
+                reader.set_error(error_code::opaque_value);
+            }
+        }
+    }
+
+    /*
+     * Walk the structure of the encoded value at the reader position without knowing its C++ type
+     *
+     * `visitor(offset, depth, header)` is called for every data header. The walk relies on the main / sub types of the
+     * headers only: containers of scalars are skipped in O(1), containers are descended into, records are stepped over
+     * field by field. Pairs, tuples, PODs and custom types do not record the types of their members, neither do the
+     * variants of the compact layout (format 0.2), the walk stops there with `error_code::opaque_value`, use
+     * `skip_object` with the C++ type instead. The value at the reader position must start with a data header.
+     */
+    template <class _Visitor>
+    error_code walk(bytes_reader_bounded &reader, _Visitor &&visitor)
+    {
+        detail::walk_value(reader, visitor, 0);
+
+        return reader.error();
+    }
+
+    /*
+     * Skip the encoded value at the reader position without knowing its C++ type, see `walk` for the limits
+     */
+    inline error_code skip_value(bytes_reader_bounded &reader)
+    {
+        return walk(reader, [](std::size_t, std::size_t, const data_header &) {});
+    }
+
+    /*
+     * Check in a single pass that packed data produced by `serialize` can be decoded as `_Ty`
+     * Nothing is allocated except for custom types which have to be decoded, see `skip_object`
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code validate(const void *buffer, std::size_t length, _CheckSum checksum = empty_checksum{})
+    {
+        auto data = static_cast<const std::uint8_t *>(buffer);
+
+        auto code = detail::check_packer_header(data, length, checksum);
+
+        if (code != error_code::none)
+            return code;
+
+        packer_header ph{};
+
+        memcpy(&ph, data, sizeof(ph));
+
+        bytes_reader_bounded reader{data, sizeof(packer_header) + ph.length};
+
+        reader.set_format(ph.version);
+
+        reader.skip(sizeof(packer_header));
+
+        skip_object<_Ty>(reader);
+
+        if (reader.good() && reader.remaining() != 0)
+            reader.set_error(error_code::length_mismatch);
+
+        return reader.error();
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code validate(const std::vector<std::uint8_t> &data, _CheckSum checksum = empty_checksum{})
+    {
+        return validate<_Ty>(data.data(), data.size(), checksum);
+    }
+
+    /*
+     * Debugging aid, describe the structure of an encoded value (the payload behind the packer header) as text
+     * `version` is the format version of the packer header
+     */
+    inline std::string dump(const void *buffer, std::size_t length, std::uint16_t version = VERSION)
+    {
+        bytes_reader_bounded reader{static_cast<const std::uint8_t *>(buffer), length};
+
+        reader.set_format(version);
+
+        std::string result{};
+
+        auto code = walk(reader, [&result](std::size_t offset, std::size_t depth, data_header header)
+                         {
+            char line[128];
+
+            /* d_pod is a main type, the same sub type is a sequence of bits */
+            auto sub_type = header.get_main_type() == d_seq_container && header.get_sub_type() == d_bits ? "bits" : data_type_name(header.get_sub_type());
+
+            snprintf(line, sizeof(line), "%*s@%zu %s<%s> length=%u\n", static_cast<int>(depth * 2), "", offset,
+                     data_type_name(header.get_main_type()), sub_type, header.length);
+
+            result += line; });
+
+        if (code != error_code::none)
+        {
+            char line[128];
+
+            snprintf(line, sizeof(line), "@%zu %s\n", reader.error_offset(),
+                     code == error_code::opaque_value ? "<opaque, the C++ type is needed to go further>" : "<malformed>");
+
+            result += line;
+        }
+
+        return result;
+    }
+
+
+    /*
+     * A member of a tagged record, binds a field id to the value to write or to read into
+     * Ids identify the fields across versions of the type and must not be reused for a different type
+     */
+    template <class _Ty>
+    struct record_field
+    {
+        std::uint16_t id;
+        _Ty &value;
+    };
+
+    template <class _Ty>
+    record_field<_Ty> field(std::uint16_t id, _Ty &value)
+    {
+        return {id, value};
+    }
+
+    namespace detail
+    {
+        /* wire size of the tag of a record field: uint16 id | uint32 length */
+        constexpr std::size_t record_field_tag_size = sizeof(std::uint16_t) + sizeof(std::uint32_t);
+
+        template <class _Writer, class _Ty>
+        void write_record_field(_Writer &writer, std::uint16_t id, const _Ty &value)
+        {
+            using _Vty = remove_cvref_t<_Ty>;
+
+            writer << id;
+
+            if constexpr (static_nested_size_impl<_Vty>() != dynamic_wire_size)
+            {
+                writer << static_cast<std::uint32_t>(static_nested_size_impl<_Vty>()) << value;
+            }
+            else if constexpr (has_overwrite_v<_Writer>)
+            {
+                /* write a placeholder and patch in the length once the value is written */
+                auto _pos = writer.count();
+
+                writer << std::uint32_t{0} << value;
+
+                auto _length = static_cast<std::uint32_t>(writer.count() - _pos - sizeof(std::uint32_t));
+
+                writer.overwrite(_pos, &_length, sizeof(_length));
             }
             else
             {
-                std::for_each(object.begin(), object.end(), [&size](auto &v)
-                              { get_object_size(v, size); });
+                std::vector<std::uint8_t> _buffer{};
+                bytes_writer _writer{_buffer};
+
+                copy_format(writer, _writer);
+
+                _writer << value;
+
+                writer << static_cast<std::uint32_t>(_buffer.size());
+
+                write_raw(writer, _buffer.data(), _buffer.size());
             }
         }
-        else if constexpr (has_iterator_v<remove_cvref_t<_Ty>> && has_value_type_v<remove_cvref_t<_Ty>>)
-        {
-            using value_type = typename remove_cvref_t<_Ty>::value_type;
 
-            size += header_size;
+        template <class _Reader, class _Ty>
+        bool read_record_field(_Reader &reader, std::uint16_t wire_id, std::uint32_t length, std::uint16_t id, _Ty &value)
+        {
+            if (wire_id != id)
+                return false;
 
-            if constexpr (get_data_type<value_type>() < d_pod)
+            if constexpr (has_consume_bytes_v<_Reader>)
             {
-                size += sizeof(value_type) * object.size();
+                /* a malformed value can not read into the next fields */
+                auto _data = reader.consume_bytes(length);
+
+                if (!_data)
+                    return true;
+
+                bytes_reader_bounded _reader{_data, length};
+
+                copy_format(reader, _reader);
+
+                _reader >> value;
+
+                if (!_reader.good())
+                    report_error(reader, _reader.error());
             }
             else
             {
-                std::for_each(object.begin(), object.end(), [&size](auto &v)
-                              { get_object_size(v, size); });
+                reader >> value;
             }
+
+            return true;
         }
-        else if constexpr (std::is_trivially_copyable_v<remove_cvref_t<_Ty>>)
+
+        template <class _Reader>
+        void skip_record_fields(_Reader &reader, std::size_t count)
         {
-            if constexpr (std::is_compound_v<_Ty>)
+            if (count > reader.remaining() / record_field_tag_size)
+                return reader.set_error(error_code::short_buffer);
+
+            for (std::size_t i = 0; i < count && reader.good(); ++i)
             {
-                size += header_size;
+                reader.skip(sizeof(std::uint16_t));
+                reader.skip(reader.template read<std::uint32_t>());
             }
+        }
+    }
 
-            size += sizeof(_Ty);
+    /*
+     * Write the fields of a custom type as a tagged record, meant to be called from its `serialize`
+     *
+     * layout: data_header{d_record, field count} | per field: uint16 id | uint32 length | value
+     *
+     * Unlike the positional `writer << a << b`, a reader built against an older or newer version of the type skips the
+     * fields it does not know by their lengths and leaves the fields it does not find untouched, so fields can be added
+     * and removed without breaking either side. Each field costs 6 bytes, lengths of values whose size depends on their
+     * content are patched in after the value when the writer supports `overwrite`.
+     */
+    template <class _Writer, class... _Fields>
+    void write_record(_Writer &writer, const record_field<_Fields> &...fields)
+    {
+        /* fields skipped by a reader must not hold the first occurrence of a string */
+        detail::string_table_suspension<_Writer> _suspension{writer};
+
+        data_header _header{d_record, static_cast<std::uint32_t>(sizeof...(_Fields))};
+
+        writer << _header;
+
+        (detail::write_record_field(writer, fields.id, fields.value), ...);
+    }
+
+    /*
+     * Read a record written by `write_record`, meant to be called from `deserialize` of a custom type
+     *
+     * Fields are matched by id in any order, unknown fields are skipped in O(1) and missing fields keep their values.
+     * A known field is decoded from its recorded length only, the bytes it does not consume are skipped.
+     */
+    template <class _Reader, class... _Fields>
+    void read_record(_Reader &reader, const record_field<_Fields> &...fields)
+    {
+        detail::string_table_suspension<_Reader> _suspension{reader};
+
+        auto _header = reader.template read<data_header>();
+
+        if (!reader.good())
+            return;
+
+        if (_header.get_main_type() != d_record)
+            return reader.set_error(error_code::type_mismatch);
+
+        if (_header.length > reader.remaining() / detail::record_field_tag_size)
+            return reader.set_error(error_code::short_buffer);
+
+        for (std::uint32_t i = 0; i < _header.length && reader.good(); ++i)
+        {
+            auto _id = reader.template read<std::uint16_t>();
+            auto _length = reader.template read<std::uint32_t>();
+
+            if (!reader.good())
+                return;
+
+            if (_length > reader.remaining())
+                return reader.set_error(error_code::short_buffer);
+
+            auto _begin = reader.count();
+
+            if (!(detail::read_record_field(reader, _id, _length, fields.id, fields.value) || ...))
+            {
+                reader.skip(_length);
+                continue;
+            }
+
+            auto _consumed = reader.count() - _begin;
+
+            if (_consumed > _length)
+                return reader.set_error(error_code::length_mismatch);
+
+            reader.skip(_length - _consumed);
         }
-        else
+    }
+
+    /*
+     * Size estimation of a record, to be used in `get_size` of the custom type
+     */
+    template <class... _Fields>
+    std::size_t get_record_size(const record_field<_Fields> &...fields)
+    {
+        return sizeof(data_header) + ((detail::record_field_tag_size + get_size(fields.value)) + ... + 0);
+    }
+
+
+    namespace detail
+    {
+        template <class _Ty>
+        constexpr bool is_random_access_container_v =
+            std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<typename _Ty::iterator>::iterator_category>;
+
+        template <class _Container>
+        const auto &key_of(const typename _Container::value_type &value)
         {
-            static_assert(
-                Always_false<_Ty>,
-                "_Ty must implement \"size_t _Ty::get_size() const\"");
+            if constexpr (has_mapped_type_v<_Container>)
+                return value.first;
+            else
+                return value;
         }
     }
 
     /*
-     * Calculate the memory space size needed for serialization / deserialization of the object
+     * Write what changed from `base` to `current`, to be patched into `base` with `read_delta`
+     *
+     * associative containers: data_header{d_aso_container, upserted count} | upserted elements
+     *                         | data_header{d_seq_container, removed count} | removed keys
+     * sequence containers:    data_header{d_seq_container, range count} | uint32 size
+     *                         | per range: uint32 offset | uint32 count | elements
+     *
+     * Elements are compared with `operator==`, keys must be unique. Sequences must be random access, a range covers a
+     * run of changed elements and the elements appended to `base`.
      */
-    template <class _Ty>
-    constexpr std::size_t get_size(const _Ty &object)
+    template <class _Writer, class _Ty>
+    void write_delta(_Writer &writer, const _Ty &base, const _Ty &current)
     {
-        std::size_t result{};
+        using value_type = typename _Ty::value_type;
 
-        get_object_size(object, result);
+        if constexpr (is_associated_container_v<_Ty>)
+        {
+            using key_type = typename _Ty::key_type;
 
-        return result;
+            std::vector<const value_type *> _upserted{};
+            std::vector<const key_type *> _removed{};
+
+            for (auto &v : current)
+            {
+                auto it = base.find(detail::key_of<_Ty>(v));
+
+                if (it == base.end() || !(*it == v))
+                    _upserted.push_back(std::addressof(v));
+            }
+
+            for (auto &v : base)
+            {
+                if (current.find(detail::key_of<_Ty>(v)) == current.end())
+                    _removed.push_back(std::addressof(detail::key_of<_Ty>(v)));
+            }
+
+            data_header _header{d_aso_container, static_cast<std::uint32_t>(_upserted.size())};
+
+            _header.set_sub_type(get_data_type<value_type>());
+
+            writer << _header;
+
+            for (auto v : _upserted)
+                writer << *v;
+
+            _header = data_header{d_seq_container, static_cast<std::uint32_t>(_removed.size())};
+
+            _header.set_sub_type(get_data_type<key_type>());
+
+            writer << _header;
+
+            for (auto k : _removed)
+                writer << *k;
+        }
+        else if constexpr (is_sequence_container_v<_Ty> && detail::is_random_access_container_v<_Ty>)
+        {
+            /* [offset, offset + count) */
+            std::vector<std::pair<std::size_t, std::size_t>> _ranges{};
+
+            auto _common = (std::min)(base.size(), current.size());
+
+            for (std::size_t i = 0; i < _common; ++i)
+            {
+                if (base[i] == current[i])
+                    continue;
+
+                if (!_ranges.empty() && _ranges.back().first + _ranges.back().second == i)
+                    ++_ranges.back().second;
+                else
+                    _ranges.emplace_back(i, 1);
+            }
+
+            if (current.size() > _common)
+            {
+                if (!_ranges.empty() && _ranges.back().first + _ranges.back().second == _common)
+                    _ranges.back().second += current.size() - _common;
+                else
+                    _ranges.emplace_back(_common, current.size() - _common);
+            }
+
+            data_header _header{d_seq_container, static_cast<std::uint32_t>(_ranges.size())};
+
+            _header.set_sub_type(get_data_type<value_type>());
+
+            writer << _header << static_cast<std::uint32_t>(current.size());
+
+            for (auto [offset, count] : _ranges)
+            {
+                writer << static_cast<std::uint32_t>(offset) << static_cast<std::uint32_t>(count);
+
+                for (std::size_t i = offset; i < offset + count; ++i)
+                    writer << current[i];
+            }
+        }
+        else
+        {
+            static_assert(Always_false<_Ty>, "deltas are supported for associative and random access sequence containers");
+        }
     }
 
     /*
-     * Serialize a object to binary format
+     * Patch a delta written by `write_delta` into `object`, which must equal the `base` it was computed against
+     * On failure `object` is left partially patched
      */
-    template <class _Ty, class _Writer = bytes_writer>
-    void serialize_object(_Writer &writer, const _Ty &object)
+    template <class _Reader, class _Ty>
+    void read_delta(_Reader &reader, _Ty &object)
     {
-        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be serialized can not be pointer type");
+        using value_type = typename _Ty::value_type;
 
-        if constexpr (has_serialize_v<_Ty>)
+        auto _header = reader.template read<data_header>();
+
+        if (!reader.good())
+            return;
+
+        if constexpr (is_associated_container_v<_Ty>)
         {
-            object.serialize(writer);
+            using key_type = typename _Ty::key_type;
+
+            if (_header.get_main_type() != d_aso_container || !_header.template is_subtype_compitable<value_type>())
+                return reader.set_error(error_code::type_mismatch);
+
+            if (_header.length > reader.remaining() / detail::min_nested_size<value_type>())
+                return reader.set_error(error_code::short_buffer);
+
+            for (std::uint32_t i = 0; i < _header.length && reader.good(); ++i)
+            {
+                if constexpr (has_mapped_type_v<_Ty> && std::is_trivially_copyable_v<value_type>)
+                {
+                    /* stored as it is, padding included, see `emplace_element` */
+                    auto _element = detail::read_map_element<_Ty>(reader);
+
+                    if (reader.good())
+                        object.insert_or_assign(std::move(_element.first), std::move(_element.second));
+                }
+                else if constexpr (has_mapped_type_v<_Ty>)
+                {
+                    auto _pair = reader.template read<data_header>();
+
+                    if (_pair.length != 2 || _pair.get_main_type() != d_pair)
+                        return reader.set_error(error_code::type_mismatch);
+
+                    auto it = object.try_emplace(reader.template read<key_type>()).first;
+
+                    detail::read_into(reader, it->second);
+                }
+                else
+                {
+                    object.insert(reader.template read<value_type>());
+                }
+            }
+
+            _header = reader.template read<data_header>();
+
+            if (!reader.good())
+                return;
+
+            if (_header.get_main_type() != d_seq_container || !_header.template is_subtype_compitable<key_type>())
+                return reader.set_error(error_code::type_mismatch);
+
+            if (_header.length > reader.remaining() / detail::min_nested_size<key_type>())
+                return reader.set_error(error_code::short_buffer);
+
+            for (std::uint32_t i = 0; i < _header.length && reader.good(); ++i)
+                object.erase(reader.template read<key_type>());
         }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::pair>)
+        else if constexpr (is_sequence_container_v<_Ty> && detail::is_random_access_container_v<_Ty>)
         {
-            data_header _header{d_pair, 2};
+            if (_header.get_main_type() != d_seq_container || !_header.template is_subtype_compitable<value_type>())
+                return reader.set_error(error_code::type_mismatch);
 
-            writer << _header;
+            auto _size = reader.template read<std::uint32_t>();
+
+            if (!reader.good())
+                return;
+
+            /* each range costs its offset and count, the elements past `object` are all in the ranges */
+            if (_header.length > reader.remaining() / (2 * sizeof(std::uint32_t)))
+                return reader.set_error(error_code::short_buffer);
+
+            if (_size > object.size() && _size - object.size() > reader.remaining() / detail::min_nested_size<value_type>())
+                return reader.set_error(error_code::short_buffer);
+
+            object.resize(_size);
+
+            for (std::uint32_t r = 0; r < _header.length && reader.good(); ++r)
+            {
+                auto _offset = reader.template read<std::uint32_t>();
+                auto _count = reader.template read<std::uint32_t>();
+
+                if (!reader.good())
+                    return;
+
+                if (_offset > _size || _count > _size - _offset)
+                    return reader.set_error(error_code::length_mismatch);
+
+                for (std::uint32_t i = _offset; i < _offset + _count && reader.good(); ++i)
+                    detail::read_into(reader, object[i]);
+            }
+        }
+        else
+        {
+            static_assert(Always_false<_Ty>, "deltas are supported for associative and random access sequence containers");
+        }
+    }
+
+    /*
+     * Pack the changes from `base` to `current` behind a packer header, see `write_delta`
+     * Deltas chain: apply them in order, each one to the state the previous one produced
+     * An empty vector is returned if an element reports an error while it is written
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    std::vector<std::uint8_t> serialize_delta(const _Ty &base, const _Ty &current, _CheckSum checksum = empty_checksum{})
+    {
+        return detail::pack(checksum, [&base, &current](bytes_writer &writer)
+        {
+            write_delta(writer, base, current);
+        });
+    }
+
+    /*
+     * Patch a delta packed by `serialize_delta` into `object`
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code apply_delta(_Ty &object, const void *buffer, std::size_t length, _CheckSum checksum = empty_checksum{})
+    {
+        auto data = static_cast<const std::uint8_t *>(buffer);
+
+        auto code = detail::check_packer_header(data, length, checksum);
+
+        if (code != error_code::none)
+            return code;
+
+        packer_header ph{};
+
+        memcpy(&ph, data, sizeof(ph));
+
+        bytes_reader_bounded reader{data, sizeof(packer_header) + ph.length};
+
+        reader.set_format(ph.version);
+
+        reader.skip(sizeof(packer_header));
+
+        read_delta(reader, object);
+
+        if (reader.good() && reader.remaining() != 0)
+            reader.set_error(error_code::length_mismatch);
+
+        return reader.error();
+    }
+
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code apply_delta(_Ty &object, const std::vector<std::uint8_t> &data, _CheckSum checksum = empty_checksum{})
+    {
+        return apply_delta(object, data.data(), data.size(), checksum);
+    }
+
+    /*
+     * Fold a chain of deltas into the snapshot they start from, `snapshot` is left untouched on failure
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code compact_deltas(std::vector<std::uint8_t> &snapshot, const std::vector<std::vector<std::uint8_t>> &deltas,
+                              _CheckSum checksum = empty_checksum{})
+    {
+        auto object = try_deserialize<_Ty>(snapshot, checksum);
+
+        if (!object)
+            return object.error();
 
-            using _first_type = typename remove_cvref_t<_Ty>::first_type;
-            using _second_type = typename remove_cvref_t<_Ty>::second_type;
+        for (auto &delta : deltas)
+        {
+            auto code = apply_delta(*object, delta, checksum);
 
-            writer << object.first;
-            writer << object.second;
+            if (code != error_code::none)
+                return code;
         }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::variant>)
-        {
-            using _Variant = remove_cvref_t<_Ty>;
 
-            data_header _header{d_variant, std::variant_size_v<_Variant>};
+        snapshot = serialize(*object, checksum);
 
-            std::visit([&_header, &writer, &object](auto &&val)
-                       {
-				using value_type = std::decay_t<decltype(val)>;
+        return error_code::none;
+    }
 
-				_header.set_sub_type(get_data_type<value_type>());
 
-				writer << _header << static_cast<uint32_t>(object.index()) << val; }, object);
-        }
-        else if constexpr (is_specialize_of_v<remove_cvref_t<_Ty>, std::tuple>)
-        {
-            using _Tuple = remove_cvref_t<_Ty>;
+    /*
+     * How `serialize_chunked` splits the payload into chunks
+     *
+     * Fixed chunks are `average` bytes long. Content-defined chunks end where a rolling hash of the preceding 64 bytes
+     * has its top log2(average) bits clear, so bytes inserted or removed only change the chunks around them and the
+     * following ones line up with the previous snapshot again. Their lengths stay within [minimum, maximum] and are about
+     * `minimum + average` on average, `average` is rounded down to a power of two. A `maximum` below `minimum` is
+     * raised to it, and chunks are at least a byte long.
+     */
+    struct chunking
+    {
+        std::size_t average{32 * 1024};
+        std::size_t minimum{16 * 1024};
+        std::size_t maximum{256 * 1024};
+        bool content_defined{true};
+    };
 
-            writer << data_header{d_tuple, std::tuple_size_v<_Tuple>};
+    /*
+     * A chunk of the payload, `offset` is relative to the payload and `crc` is a crc32 of its bytes
+     */
+    struct chunk_entry
+    {
+        std::size_t offset;
+        std::uint32_t length;
+        std::uint32_t crc;
+    };
 
-            detail::serialize_tuple_impl(writer, object, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
-        }
-        else if constexpr (is_standard_container_v<remove_cvref_t<_Ty>>)
-        {
-            using container_type = remove_cvref_t<_Ty>;
-            using value_type = typename container_type::value_type;
+    namespace detail
+    {
+        /* "ZPCK" */
+        constexpr std::uint32_t chunk_table_magic = 0x4b43505a;
 
-            data_header _header{};
+        /* wire size of the footer: uint32 chunk count | uint32 crc32 of the entries | uint32 magic */
+        constexpr std::size_t chunk_footer_size = 3 * sizeof(std::uint32_t);
 
-            if constexpr (is_sequence_container_v<container_type>)
-            {
-                _header.set_main_type(d_seq_container);
-                _header.set_sub_type(get_data_type<value_type>());
-            }
-            else if constexpr (is_associated_container_v<container_type>)
-            {
-                _header.set_main_type(d_aso_container);
-                _header.set_sub_type(get_data_type<value_type>());
-            }
-            /* std::array, std::initializer_list, etc. */
-            else
-            {
-                _header.set_main_type(d_seq_container);
-                _header.set_sub_type(get_data_type<value_type>());
-            }
+        /* wire size of an entry: uint32 length | uint32 crc32 */
+        constexpr std::size_t chunk_entry_size = 2 * sizeof(std::uint32_t);
 
-            _header.length = static_cast<std::uint32_t>(object.size());
+        constexpr std::uint64_t splitmix64(std::uint64_t &state)
+        {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
 
-            writer << _header;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
 
-            std::for_each(object.begin(), object.end(), [&writer](auto &v)
-                          { writer << v; });
+            return z ^ (z >> 31);
         }
-        /* std::forward_list goes here */
-        else if constexpr (has_iterator_v<remove_cvref_t<_Ty>> && has_value_type_v<remove_cvref_t<_Ty>>)
-        {
-            using container_type = remove_cvref_t<_Ty>;
-            using value_type = typename container_type::value_type;
 
-            data_header _header{};
+        constexpr auto generate_gear_table()
+        {
+            std::array<std::uint64_t, 256> table = {};
+            std::uint64_t state = 0x7a7061636b6572ull;
 
-            _header.set_main_type(d_seq_container);
-            _header.set_sub_type(get_data_type<value_type>());
+            for (std::size_t i = 0; i < table.size(); ++i)
+                table[i] = splitmix64(state);
 
-            if constexpr (has_size_v<container_type>)
-            {
-                _header.length = static_cast<std::uint32_t>(object.size());
+            return table;
+        }
 
-                writer << _header;
+        static constexpr std::array<std::uint64_t, 256> GEAR_TABLE = generate_gear_table();
 
-                std::for_each(object.begin(), object.end(), [&writer](auto &v)
-                              { writer << v; });
-            }
-            else
-            {
-                std::uint32_t _size{0};
-                std::vector<std::uint8_t> _partial;
+        /* length of the chunk starting at `data` */
+        inline std::size_t next_chunk_length(const std::uint8_t *data, std::size_t length, const chunking &options)
+        {
+            if (!options.content_defined)
+                return (std::min)(length, (std::max)(options.average, std::size_t{1}));
 
-                _partial.reserve(_default_reserve_size);
+            if (length <= options.minimum)
+                return length;
 
-                bytes_writer _writer{_partial};
+            /* a chunk is never empty nor cut below the minimum, whatever the options say */
+            const auto limit = (std::min)(length, (std::max)({options.maximum, options.minimum, std::size_t{1}}));
 
-                std::for_each(object.begin(), object.end(), [&_writer, &_partial, &_size](auto &v)
-                              {
-					_writer << v;
-					++_size; });
+            /* the low bits of the hash only see the last few bytes, test the high ones */
+            int bits = 0;
 
-                _header.length = _size;
+            while ((std::size_t{2} << bits) <= options.average && bits < 63)
+                ++bits;
 
-                _partial.shrink_to_fit();
+            const std::uint64_t mask = bits == 0 ? 0 : ~std::uint64_t{0} << (64 - bits);
 
-                writer << _header;
+            /* the hash only depends on the last 64 bytes, there is no need to roll it over the minimum length */
+            std::size_t i = options.minimum > 64 ? options.minimum - 64 : 0;
+            std::uint64_t hash = 0;
 
-                writer.write(_partial);
-            }
-        }
-        else if constexpr (std::is_trivially_copyable_v<remove_cvref_t<_Ty>>)
-        {
-            if constexpr (std::is_compound_v<_Ty>)
+            for (; i < limit; ++i)
             {
-                writer << data_header{d_pod, static_cast<std::uint32_t>(sizeof(_Ty))};
+                hash = (hash << 1) + GEAR_TABLE[data[i]];
+
+                if (i + 1 >= options.minimum && (hash & mask) == 0)
+                    return i + 1;
             }
 
-            writer << object;
-        }
-        else
-        {
-            static_assert(
-                Always_false<_Ty>,
-                "_Ty to serialize must be either of a standard STL container type, custom containers that implement standard iterator, "
-                "POD type or custom types that implement serialize() method");
+            return limit;
         }
     }
 
     /*
-     * Deserialize a object from binary format
+     * Chunk table of a blob written by `serialize_chunked`, the blob must outlive it
+     *
+     * Only the chunks a read touches need to be verified, see `verify`. Verified chunks are remembered.
      */
-    template <
-        class _Ty,
-        class _Reader = bytes_reader,
-        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
-    _Ty deserialize_object(_Reader &reader)
+    class chunk_table
     {
-        static_assert(!std::is_pointer_v<remove_cvref_t<_Ty>>, "value_type in container _Ty to be deserialized can not be pointer type");
-
-        if constexpr (has_deserialize_v<_Ty>)
-        {
-            return _Ty::deserialize(reader);
-        }
-        else if constexpr (is_specialize_of_v<_Ty, std::pair>)
+    public:
+        /*
+         * Locate the chunk table at the end of the blob and check its own crc, the chunks are not verified
+         */
+        error_code parse(const void *buffer, std::size_t length)
         {
-            using first_type = typename _Ty::first_type;
-            using second_type = typename _Ty::second_type;
+            auto data = static_cast<const std::uint8_t *>(buffer);
 
-            auto _header = reader.template read<data_header>();
-
-            // runtime check
-            if (_header.length != 2 || _header.get_main_type() != d_pair)
-                return _Ty{};
+            m_chunks.clear();
+            m_verified.clear();
 
-            return _Ty{reader.template read<first_type>(), reader.template read<second_type>()};
-        }
-        else if constexpr (is_specialize_of_v<_Ty, std::variant>)
-        {
-            using _Variant = _Ty;
+            if (length < sizeof(packer_header) + detail::chunk_footer_size)
+                return error_code::short_buffer;
 
-            auto _header = reader.template read<data_header>();
+            packer_header ph{};
 
-            if (_header.length != std::variant_size_v<_Variant>)
-                return _Variant{};
+            memcpy(&ph, data, sizeof(ph));
 
-            auto _index = reader.template read<uint32_t>();
+            if (ph.version < VERSION_OLDEST || ph.version > VERSION)
+                return error_code::version_mismatch;
 
-            if (_index > _header.length)
-                return _Variant{};
+            auto footer = data + length - detail::chunk_footer_size;
+            auto count = detail::load_u32(footer);
 
-            return detail::deserialize_variant_impl<_Variant>(reader, _index, std::make_index_sequence<std::variant_size_v<_Variant>>{});
-        }
-        else if constexpr (is_specialize_of_v<_Ty, std::tuple>)
-        {
-            using _Tuple = _Ty;
+            if (detail::load_u32(footer + 2 * sizeof(std::uint32_t)) != detail::chunk_table_magic)
+                return error_code::type_mismatch;
 
-            auto _header = reader.template read<data_header>();
+            if (count > (length - sizeof(packer_header) - detail::chunk_footer_size) / detail::chunk_entry_size ||
+                sizeof(packer_header) + std::size_t{ph.length} + count * detail::chunk_entry_size + detail::chunk_footer_size != length)
+                return error_code::length_mismatch;
 
-            if (_header.length != std::tuple_size_v<_Tuple>)
-                return _Ty{};
+            auto entries = footer - count * detail::chunk_entry_size;
 
-            return detail::deserialize_tuple_impl<_Tuple>(reader, std::make_index_sequence<std::tuple_size_v<_Tuple>>{});
-        }
-        else if constexpr (is_standard_container_v<_Ty>)
-        {
-            using value_type = typename _Ty::value_type;
+            if (crc32_checksum{}(entries, count * detail::chunk_entry_size) != detail::load_u32(footer + sizeof(std::uint32_t)))
+                return error_code::checksum_mismatch;
 
-            auto _header = reader.template read<data_header>();
+            m_chunks.reserve(count);
 
-            std::remove_cv_t<_Ty> container{};
+            std::size_t offset = 0;
 
-            if constexpr (is_sequence_container_v<_Ty>)
+            for (std::uint32_t i = 0; i < count; ++i)
             {
-                // runtime check
-                if (_header.get_main_type() == d_seq_container &&
-                    _header.template is_subtype_compitable<value_type>())
-                {
-                    for (std::uint32_t i = 0; i < _header.length; i++)
-                    {
-                        container.push_back(reader.template read<value_type>());
-                    }
-                }
+                auto entry = entries + i * detail::chunk_entry_size;
+                auto chunk_length = detail::load_u32(entry);
+
+                m_chunks.push_back(chunk_entry{offset, chunk_length, detail::load_u32(entry + sizeof(std::uint32_t))});
+
+                offset += chunk_length;
             }
-            else if constexpr (is_associated_container_v<_Ty>)
+
+            if (offset != ph.length)
             {
-                // runtime check
-                if (_header.get_main_type() == d_aso_container &&
-                    _header.template is_subtype_compitable<value_type>())
-                {
-                    for (std::uint32_t i = 0; i < _header.length; i++)
-                    {
-                        container.insert(reader.template read<value_type>());
-                    }
-                }
+                m_chunks.clear();
+                return error_code::length_mismatch;
             }
 
-            return container;
+            m_verified.assign(count, 0);
+            m_payload = data + sizeof(packer_header);
+            m_payload_size = ph.length;
+            m_version = ph.version;
+
+            return error_code::none;
         }
-        else if constexpr (std::is_trivially_copyable_v<_Ty>)
+
+        /*
+         * Verify the chunks overlapping [offset, offset + length) of the payload
+         */
+        error_code verify(std::size_t offset, std::size_t length)
         {
-            if constexpr (std::is_compound_v<_Ty>)
-            {
-                auto _header = reader.template read<data_header>();
+            if (offset > m_payload_size || length > m_payload_size - offset)
+                return error_code::short_buffer;
 
-                // runtime check
-                if (_header.length < sizeof(_Ty))
-                    return _Ty{};
+            auto first = std::upper_bound(m_chunks.begin(), m_chunks.end(), offset, [](std::size_t value, const chunk_entry &chunk)
+                                          { return value < chunk.offset; });
+
+            for (auto i = static_cast<std::size_t>(std::distance(m_chunks.begin(), first)) - 1;
+                 i < m_chunks.size() && m_chunks[i].offset < offset + (std::max)(length, std::size_t{1}); ++i)
+            {
+                if (!verify_chunk(i))
+                    return error_code::checksum_mismatch;
             }
 
-            return reader.template read<_Ty>();
+            return error_code::none;
         }
-        else
-        {
-            static_assert(
-                Always_false<_Ty>,
-                "_Ty to deserialize must be either of a standard STL container type, custom containers that implement standard iterator, "
-                "POD type, arithmetic type or custom types that implement deserialize() method");
-        }
-    }
 
-    template <
-        class _Ty,
-        class _CheckSum = empty_checksum>
-    std::vector<std::uint8_t> serialize(const _Ty &value, _CheckSum checksum = empty_checksum{})
-    {
-        std::vector<std::uint8_t> data{};
-        std::vector<std::uint8_t> result{};
-
-        data.reserve(_default_reserve_size);
+        /*
+         * Verify every chunk, `concurrency` > 1 spreads the chunks over threads
+         */
+        error_code verify_all(std::size_t concurrency = 1)
+        {
+            std::atomic<bool> failed{false};
 
-        bytes_writer writer{data};
+            detail::parallel_slices(m_chunks.size(), concurrency, [this, &failed](std::size_t begin, std::size_t end)
+                                    {
+                for (auto i = begin; i < end; ++i)
+                {
+                    if (!verify_chunk(i))
+                        failed = true;
+                } });
 
-        // serialization
-        serialize_object(writer, value);
+            return failed ? error_code::checksum_mismatch : error_code::none;
+        }
 
-        data.shrink_to_fit();
+        const std::uint8_t *payload() const
+        {
+            return m_payload;
+        }
 
-        result.reserve(data.size() + sizeof(packer_header));
+        std::size_t payload_size() const
+        {
+            return m_payload_size;
+        }
 
-        // insert packer header
-        packer_header ph{};
+        /*
+         * Format version of the packer header
+         */
+        std::uint16_t version() const
+        {
+            return m_version;
+        }
 
-        ph.set_version(VERSION);
+        const std::vector<chunk_entry> &chunks() const
+        {
+            return m_chunks;
+        }
 
-        ph.crc.crc32 = checksum(data.data(), data.size());
+    private:
+        bool verify_chunk(std::size_t i)
+        {
+            if (m_verified[i])
+                return true;
 
-        ph.length = static_cast<std::uint32_t>(data.size());
+            auto &chunk = m_chunks[i];
 
-        writer.reset(result);
+            if (crc32_checksum{}(m_payload + chunk.offset, chunk.length) != chunk.crc)
+                return false;
 
-        writer << ph;
-        writer.write(data);
+            m_verified[i] = 1;
 
-        result.shrink_to_fit();
+            return true;
+        }
 
-        return result;
-    }
+        const std::uint8_t *m_payload{nullptr};
+        std::size_t m_payload_size{0};
+        std::uint16_t m_version{VERSION};
+        std::vector<chunk_entry> m_chunks;
+        std::vector<std::uint8_t> m_verified;
+    };
 
+    /*
+     * Serialize a object into a block-structured blob
+     *
+     * layout: packer_header | payload | per chunk: uint32 length | uint32 crc32
+     *         | uint32 chunk count | uint32 crc32 of the chunk entries | uint32 "ZPCK"
+     *
+     * The packer header and the payload are those of `serialize`, `deserialize` reads the blob as it is and ignores the
+     * chunk table behind the payload. `chunk_table` verifies the chunks separately, see `deserialize_chunked`. Chunks
+     * of two snapshots with the same length and crc are candidates for deduplication.
+     *
+     * An empty vector is returned if the object reports an error while it is written.
+     */
     template <
         class _Ty,
         class _CheckSum = empty_checksum>
-    std::vector<std::uint8_t> serialize(
-        const void *buffer,
-        size_t bufsize,
-        const _Ty &value,
-        _CheckSum checksum = empty_checksum{})
+    std::vector<std::uint8_t> serialize_chunked(const _Ty &value, const chunking &options = chunking{}, _CheckSum checksum = empty_checksum{})
     {
         std::vector<std::uint8_t> result{};
 
-        bytes_writer_bounded writer{(uint8_t *)buffer, bufsize};
+        result.reserve(_default_reserve_size);
 
-        // serialization
-        writer << value;
+        if (serialize_into(result, value, checksum) != error_code::none)
+            return result;
 
-        auto length = writer.count();
+        const auto payload_size = result.size() - sizeof(packer_header);
 
-        result.reserve(writer.count() + sizeof(packer_header));
+        std::vector<std::uint8_t> entries{};
 
-        // insert packer header
-        packer_header ph{};
+        for (std::size_t offset = 0; offset < payload_size;)
+        {
+            auto data = result.data() + sizeof(packer_header) + offset;
+            auto length = detail::next_chunk_length(data, payload_size - offset, options);
 
-        ph.set_version(VERSION);
+            std::uint8_t entry[detail::chunk_entry_size];
 
-        ph.crc.crc32 = checksum((uint8_t *)buffer, length);
+            detail::store_u32(entry, static_cast<std::uint32_t>(length));
+            detail::store_u32(entry + sizeof(std::uint32_t), crc32_checksum{}(data, length));
 
-        ph.length = static_cast<std::uint32_t>(length);
+            entries.insert(entries.end(), entry, entry + sizeof(entry));
 
-        bytes_writer data_writer{result};
+            offset += length;
+        }
 
-        data_writer << ph;
-        data_writer.write((uint8_t *)buffer, length);
+        std::uint8_t footer[detail::chunk_footer_size];
 
-        result.shrink_to_fit();
+        detail::store_u32(footer, static_cast<std::uint32_t>(entries.size() / detail::chunk_entry_size));
+        detail::store_u32(footer + sizeof(std::uint32_t), crc32_checksum{}(entries.data(), entries.size()));
+        detail::store_u32(footer + 2 * sizeof(std::uint32_t), detail::chunk_table_magic);
+
+        result.insert(result.end(), entries.begin(), entries.end());
+        result.insert(result.end(), footer, footer + sizeof(footer));
 
         return result;
     }
 
+    /*
+     * Verify every chunk of a blob written by `serialize_chunked`, `concurrency` threads at once, and decode it
+     */
     template <
         class _Ty,
-        class _CheckSum = empty_checksum,
-        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
-    _Ty deserialize(const std::vector<std::uint8_t> &data, _CheckSum checksum = empty_checksum{})
+        std::enable_if_t<detail::is_deserializable_v<_Ty, bytes_reader_bounded>, int> = 0>
+    deserialize_result<_Ty> deserialize_chunked(const void *buffer, std::size_t length, std::size_t concurrency = 1)
     {
-        bytes_reader reader{data};
-
-        packer_header ph{};
-
-        reader >> ph;
+        chunk_table table{};
 
-        // check header
-        if (ph.version != VERSION)
-            return _Ty{};
-
-        // check checksum
-        std::uint32_t crc = checksum(data.data() + sizeof(packer_header), ph.length);
-        if (crc != ph.crc.crc32)
-            return _Ty{};
+        auto code = table.parse(buffer, length);
 
-        // perform deserialize
-        return deserialize_object<_Ty>(reader);
-    }
+        if (code == error_code::none)
+            code = table.verify_all(concurrency);
 
-    template <
-        class _Ty,
-        class _CheckSum = empty_checksum,
-        std::enable_if_t<std::is_default_constructible_v<_Ty>, int> = 0>
-    _Ty deserialize(
-        const void *buffer,
-        size_t length,
-        _CheckSum checksum = empty_checksum{})
-    {
-        bytes_reader_bounded reader{(uint8_t *)buffer, length};
+        if (code != error_code::none)
+            return {code, 0};
 
-        packer_header ph{};
+        bytes_reader_bounded reader{table.payload(), table.payload_size()};
 
-        reader >> ph;
+        reader.set_format(table.version());
 
-        // check header
-        if (ph.version != VERSION)
-            return _Ty{};
+        auto object = deserialize_object<_Ty>(reader);
 
-        // check checksum
-        std::uint32_t crc = checksum((uint8_t *)buffer + sizeof(packer_header), ph.length);
-        if (crc != ph.crc.crc32)
-            return _Ty{};
+        if (!reader.good())
+            return {reader.error(), sizeof(packer_header) + reader.error_offset()};
 
-        // perform deserialize
-        return deserialize_object<_Ty>(reader);
+        return object;
     }
 }
\ No newline at end of file
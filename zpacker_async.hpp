@@ -0,0 +1,916 @@
+#pragma once
+
+/*
+ * Non-blocking transport of packed frames over stream sockets (POSIX)
+ *
+ * `frame_receiver` / `frame_sender` move frames written by `serialize` through a non-blocking socket and pick up where
+ * they left off when the socket would block. With C++20 coroutines, `event_loop` (epoll, Linux) resumes
+ * `async_receive` / `async_send` once the socket is ready.
+ *
+ * `frame_receiver` decodes a frame once it is complete. `frame_decoder` (Linux, glibc) decodes it while it comes in:
+ * `deserialize_object` is synchronous and recursive, so it runs on a stack of its own that is set aside whenever the
+ * decoding gets ahead of the bytes received, and picked up again where it stopped once more bytes came in.
+ */
+
+#include "zpacker.hpp"
+
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <memory>
+#include <optional>
+#include <ucontext.h>
+#define ZPACKER_HAS_FIBERS 1
+#endif
+
+#if defined(__cpp_impl_coroutine) && defined(__linux__)
+#include <coroutine>
+#include <exception>
+#include <unordered_map>
+#include <sys/epoll.h>
+#define ZPACKER_HAS_COROUTINES 1
+#endif
+
+namespace zeus
+{
+    enum class io_status : std::uint8_t
+    {
+        /* the whole frame went through */
+        done,
+
+        /* the socket would block, try again once it is ready */
+        would_block,
+
+        /* the peer closed the connection */
+        closed,
+
+        /* see errno */
+        failed
+    };
+
+    /*
+     * Receive frames written by `serialize` from a non-blocking socket
+     *
+     * The whole frame is buffered before it is decoded, see `frame_decoder` to decode it while it comes in. The packer
+     * header is read first, then the payload goes straight into a buffer of its exact size, so `recv` copies the frame
+     * once and `decode` reads it in place. The buffer is reused by the next frame, and a connection holds at most one
+     * frame of up to `max_payload` bytes.
+     */
+    class frame_receiver
+    {
+    public:
+        /*
+         * Frames announcing a larger payload fail with errno EMSGSIZE
+         */
+        explicit frame_receiver(std::size_t max_payload = 64 * 1024 * 1024) : m_max_payload(max_payload)
+        {
+            m_frame.resize(sizeof(packer_header));
+        }
+
+        /*
+         * Read as much of the current frame as the socket holds, the next frame starts after `done` was returned
+         */
+        io_status receive(int fd)
+        {
+            if (m_done)
+                next();
+
+            while (m_pos < m_frame.size())
+            {
+                auto n = ::recv(fd, m_frame.data() + m_pos, m_frame.size() - m_pos, 0);
+
+                if (n > 0)
+                {
+                    m_pos += static_cast<std::size_t>(n);
+
+                    if (!m_header_read && m_pos == sizeof(packer_header))
+                    {
+                        packer_header ph{};
+
+                        memcpy(&ph, m_frame.data(), sizeof(ph));
+
+                        if (ph.length > m_max_payload)
+                        {
+                            errno = EMSGSIZE;
+                            return io_status::failed;
+                        }
+
+                        m_header_read = true;
+
+                        m_frame.resize(sizeof(packer_header) + ph.length);
+                    }
+
+                    continue;
+                }
+
+                if (n == 0)
+                    return io_status::closed;
+
+                if (errno == EINTR)
+                    continue;
+
+                return errno == EAGAIN || errno == EWOULDBLOCK ? io_status::would_block : io_status::failed;
+            }
+
+            m_done = true;
+
+            return io_status::done;
+        }
+
+        /*
+         * The frame received last, packer header included
+         */
+        const std::vector<std::uint8_t> &frame() const
+        {
+            return m_frame;
+        }
+
+        template <
+            class _Ty,
+            class _CheckSum = empty_checksum>
+        deserialize_result<_Ty> decode(_CheckSum checksum = empty_checksum{}) const
+        {
+            return try_deserialize<_Ty>(m_frame, checksum);
+        }
+
+    private:
+        void next()
+        {
+            m_frame.resize(sizeof(packer_header));
+            m_pos = 0;
+            m_header_read = false;
+            m_done = false;
+        }
+
+        std::vector<std::uint8_t> m_frame;
+        std::size_t m_pos{0};
+        std::size_t m_max_payload;
+        bool m_header_read{false};
+        bool m_done{false};
+    };
+
+    /*
+     * Send a frame through a non-blocking socket
+     */
+    class frame_sender
+    {
+    public:
+        /*
+         * Queue a frame written by `serialize`, the previous one must be done
+         */
+        void assign(std::vector<std::uint8_t> frame)
+        {
+            m_frame = std::move(frame);
+            m_pos = 0;
+        }
+
+        io_status send(int fd)
+        {
+            while (m_pos < m_frame.size())
+            {
+                auto n = ::send(fd, m_frame.data() + m_pos, m_frame.size() - m_pos, MSG_NOSIGNAL);
+
+                if (n >= 0)
+                {
+                    m_pos += static_cast<std::size_t>(n);
+                    continue;
+                }
+
+                if (errno == EINTR)
+                    continue;
+
+                if (errno == EPIPE || errno == ECONNRESET)
+                    return io_status::closed;
+
+                return errno == EAGAIN || errno == EWOULDBLOCK ? io_status::would_block : io_status::failed;
+            }
+
+            return io_status::done;
+        }
+
+    private:
+        std::vector<std::uint8_t> m_frame;
+        std::size_t m_pos{0};
+    };
+
+#if defined(ZPACKER_HAS_FIBERS)
+
+    namespace detail
+    {
+        /*
+         * Stack of its own for a synchronous function that has to wait in the middle of its work: `suspend` returns to
+         * the caller of `resume`, the next `resume` picks the function up where it stopped
+         */
+        class fiber
+        {
+        public:
+            explicit fiber(std::size_t stack_size) : m_stack(new std::uint8_t[stack_size]), m_stack_size(stack_size) {}
+
+            fiber(const fiber &) = delete;
+            fiber &operator=(const fiber &) = delete;
+
+            /*
+             * Run `entry(context)` until it suspends or returns
+             */
+            void start(void (*entry)(void *), void *context)
+            {
+                m_entry = entry;
+                m_context = context;
+                m_running = true;
+                m_cancelled = false;
+
+                ::getcontext(&m_fiber);
+
+                m_fiber.uc_stack.ss_sp = m_stack.get();
+                m_fiber.uc_stack.ss_size = m_stack_size;
+                m_fiber.uc_link = &m_caller;
+
+                /* makecontext passes int arguments only */
+                const auto self = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(this));
+
+                ::makecontext(&m_fiber, reinterpret_cast<void (*)()>(&fiber::trampoline), 2,
+                              static_cast<unsigned>(self >> 32), static_cast<unsigned>(self & 0xffffffffu));
+
+                resume();
+            }
+
+            void resume()
+            {
+                ::swapcontext(&m_caller, &m_fiber);
+            }
+
+            /*
+             * Called by the function, false once the fiber is cancelled: the function has to wind up then
+             */
+            bool suspend()
+            {
+                if (!m_cancelled)
+                    ::swapcontext(&m_fiber, &m_caller);
+
+                return !m_cancelled;
+            }
+
+            /*
+             * Let a suspended function run to its end, it is never suspended again
+             */
+            void cancel()
+            {
+                m_cancelled = true;
+
+                if (m_running)
+                    resume();
+            }
+
+            bool running() const
+            {
+                return m_running;
+            }
+
+        private:
+            static void trampoline(unsigned high, unsigned low)
+            {
+                auto self = reinterpret_cast<fiber *>(static_cast<std::uintptr_t>((static_cast<std::uint64_t>(high) << 32) | low));
+
+                self->m_entry(self->m_context);
+
+                /* back to the caller of the last `resume` through uc_link */
+                self->m_running = false;
+            }
+
+            ucontext_t m_caller{};
+            ucontext_t m_fiber{};
+            std::unique_ptr<std::uint8_t[]> m_stack;
+            std::size_t m_stack_size;
+            void (*m_entry)(void *){nullptr};
+            void *m_context{nullptr};
+            bool m_running{false};
+            bool m_cancelled{false};
+        };
+    }
+
+    /*
+     * Reader of a frame that is still coming in, see `frame_decoder`
+     *
+     * The frame is read in place from a buffer of its full size. A read beyond the bytes received so far suspends the
+     * fiber the reader runs on until they are there. Bounds are checked against the length announced by the packer
+     * header, as `bytes_reader_bounded` checks them against its buffer.
+     */
+    class partial_frame_reader : public error_state, public format_state, public string_table_state
+    {
+    public:
+        partial_frame_reader(const std::uint8_t *data, std::size_t length, const std::size_t &received, detail::fiber &fiber)
+            : m_data(data), m_length(length), m_received(received), m_fiber(fiber)
+        {
+        }
+
+        template <class _Vty>
+        _Vty read()
+        {
+            if constexpr (detail::is_raw_v<_Vty>)
+            {
+                static_assert(std::is_default_constructible_v<_Vty>, "_Vty must be default constructible");
+
+                if (!wait_for(sizeof(_Vty)))
+                    return _Vty{};
+
+                _Vty result;
+
+                memcpy(std::addressof(result), m_data + m_pos, sizeof(_Vty));
+
+                m_pos += sizeof(_Vty);
+
+                return result;
+            }
+            else
+            {
+                return deserialize_object<_Vty>(*this);
+            }
+        }
+
+        template <class _Vty>
+        partial_frame_reader &operator>>(_Vty &val)
+        {
+            detail::read_into(*this, val);
+
+            return *this;
+        }
+
+        template <class _Vty, std::enable_if_t<std::is_trivially_copyable_v<_Vty>, int> = 0>
+        bool can_read() const
+        {
+            return remaining() >= sizeof(_Vty);
+        }
+
+        /*
+         * Wait for `length` bytes and return them for unchecked loads, they stay in place until the next frame
+         * Return nullptr if the frame is shorter
+         */
+        const std::uint8_t *consume_bytes(std::size_t length)
+        {
+            if (!wait_for(length))
+                return nullptr;
+
+            auto result = m_data + m_pos;
+
+            m_pos += length;
+
+            return result;
+        }
+
+        /*
+         * Bytes left in the frame, received or not
+         */
+        std::size_t remaining() const
+        {
+            return m_length - m_pos;
+        }
+
+        /*
+         * Record an error at the current position, only the first one is kept
+         */
+        void set_error(error_code code)
+        {
+            record_error(code, m_pos);
+        }
+
+        void skip(std::size_t count)
+        {
+            if (remaining() >= count)
+                m_pos += count;
+            else
+                set_error(error_code::short_buffer);
+        }
+
+        std::size_t count() const
+        {
+            return m_pos;
+        }
+
+    private:
+        /* suspend until the next `length` bytes are received, fail if the frame is shorter or the fiber is cancelled */
+        bool wait_for(std::size_t length)
+        {
+            if (remaining() < length)
+            {
+                set_error(error_code::short_buffer);
+                return false;
+            }
+
+            while (m_received < m_pos + length)
+            {
+                if (!m_fiber.suspend())
+                {
+                    set_error(error_code::short_buffer);
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        const std::uint8_t *m_data;
+        std::size_t m_length;
+        std::size_t m_pos{0};
+        const std::size_t &m_received;
+        detail::fiber &m_fiber;
+    };
+
+    /*
+     * Receive frames written by `serialize` from a non-blocking socket and decode them while they come in
+     *
+     * `deserialize_object<_Ty>` runs on a fiber with a `partial_frame_reader`. When it gets ahead of the bytes received
+     * the fiber is suspended and `receive` returns `io_status::would_block`, the next call resumes it where it stopped
+     * once more bytes came in: decoding a large frame overlaps with its transfer instead of following it. As with
+     * `frame_receiver` the payload is received once, in place, into a buffer of its exact size, which views decoded
+     * from the frame point into until the next frame starts.
+     *
+     * The checksum covers the whole payload, it is verified once the frame is complete and a mismatch turns the result
+     * into `error_code::checksum_mismatch`. The decoding runs on a stack of `stack_size` bytes, an exception thrown by
+     * it terminates the program like one escaping the coroutines of this header.
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    class frame_decoder
+    {
+    public:
+        /*
+         * Frames announcing a larger payload fail with errno EMSGSIZE
+         */
+        explicit frame_decoder(std::size_t max_payload = 64 * 1024 * 1024, std::size_t stack_size = 256 * 1024, _CheckSum checksum = _CheckSum{})
+            : m_fiber(stack_size), m_max_payload(max_payload), m_checksum(checksum)
+        {
+            m_frame.resize(sizeof(packer_header));
+        }
+
+        frame_decoder(const frame_decoder &) = delete;
+        frame_decoder &operator=(const frame_decoder &) = delete;
+
+        /* unwind a decoding left in the middle of a frame */
+        ~frame_decoder()
+        {
+            m_fiber.cancel();
+        }
+
+        /*
+         * Receive and decode as much of the current frame as the socket holds, the next frame starts after `done`
+         * was returned
+         */
+        io_status receive(int fd)
+        {
+            if (m_done)
+                next();
+
+            while (m_received < m_frame.size())
+            {
+                auto n = ::recv(fd, m_frame.data() + m_received, m_frame.size() - m_received, 0);
+
+                if (n > 0)
+                {
+                    m_received += static_cast<std::size_t>(n);
+
+                    if (!m_header_read)
+                    {
+                        if (m_received == sizeof(packer_header) && !start())
+                            return io_status::failed;
+                    }
+                    else if (m_fiber.running())
+                    {
+                        m_fiber.resume();
+                    }
+
+                    continue;
+                }
+
+                if (n == 0)
+                    return io_status::closed;
+
+                if (errno == EINTR)
+                    continue;
+
+                return errno == EAGAIN || errno == EWOULDBLOCK ? io_status::would_block : io_status::failed;
+            }
+
+            finish();
+
+            m_done = true;
+
+            return io_status::done;
+        }
+
+        /*
+         * Outcome of the frame received last
+         */
+        deserialize_result<_Ty> &result()
+        {
+            return *m_result;
+        }
+
+        /*
+         * The frame received last, packer header included
+         */
+        const std::vector<std::uint8_t> &frame() const
+        {
+            return m_frame;
+        }
+
+    private:
+        /* the packer header is in, size the frame and start decoding its payload */
+        bool start()
+        {
+            packer_header ph{};
+
+            memcpy(&ph, m_frame.data(), sizeof(ph));
+
+            if (ph.length > m_max_payload)
+            {
+                errno = EMSGSIZE;
+                return false;
+            }
+
+            m_header_read = true;
+
+            m_frame.resize(sizeof(packer_header) + ph.length);
+
+            // data packed by an older format version is still accepted
+            if (ph.version < VERSION_OLDEST || ph.version > VERSION)
+            {
+                m_result.emplace(error_code::version_mismatch, 0);
+                return true;
+            }
+
+            m_fiber.start(&frame_decoder::decode, this);
+
+            return true;
+        }
+
+        /* every byte is in, the decoding has run to its end */
+        void finish()
+        {
+            if (m_fiber.running())
+                m_fiber.resume();
+
+            packer_header ph{};
+
+            memcpy(&ph, m_frame.data(), sizeof(ph));
+
+            if (m_result->error() != error_code::version_mismatch &&
+                m_checksum(m_frame.data() + sizeof(packer_header), ph.length) != ph.crc.crc32)
+                m_result.emplace(error_code::checksum_mismatch, 0);
+        }
+
+        /* runs on the fiber, an exception can not unwind beyond its stack */
+        static void decode(void *context) noexcept
+        {
+            auto &self = *static_cast<frame_decoder *>(context);
+
+            partial_frame_reader reader{self.m_frame.data(), self.m_frame.size(), self.m_received, self.m_fiber};
+
+            reader.set_format(detail::packer_version(self.m_frame.data()));
+
+            reader.skip(sizeof(packer_header));
+
+            auto object = deserialize_object<_Ty>(reader);
+
+            if (reader.good())
+                self.m_result.emplace(std::move(object));
+            else
+                self.m_result.emplace(reader.error(), reader.error_offset());
+        }
+
+        void next()
+        {
+            m_frame.resize(sizeof(packer_header));
+            m_result.reset();
+            m_received = 0;
+            m_header_read = false;
+            m_done = false;
+        }
+
+        std::vector<std::uint8_t> m_frame;
+        std::optional<deserialize_result<_Ty>> m_result;
+        detail::fiber m_fiber;
+        std::size_t m_received{0};
+        std::size_t m_max_payload;
+        _CheckSum m_checksum;
+        bool m_header_read{false};
+        bool m_done{false};
+    };
+
+#endif
+
+#if defined(ZPACKER_HAS_COROUTINES)
+
+    /*
+     * Lazily started coroutine returning `_Ty` to the coroutine awaiting it
+     */
+    template <class _Ty>
+    class task
+    {
+    public:
+        struct promise_type
+        {
+            std::optional<_Ty> result;
+            std::coroutine_handle<> continuation{std::noop_coroutine()};
+
+            task get_return_object()
+            {
+                return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            /* hand over to the awaiting coroutine without growing the stack */
+            struct final_awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            template <class _Vty>
+            void return_value(_Vty &&value)
+            {
+                result.emplace(std::forward<_Vty>(value));
+            }
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+
+        task(task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+
+        task(const task &) = delete;
+        task &operator=(const task &) = delete;
+
+        ~task()
+        {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+        {
+            m_handle.promise().continuation = caller;
+
+            return m_handle;
+        }
+
+        _Ty await_resume()
+        {
+            return std::move(*m_handle.promise().result);
+        }
+
+    private:
+        explicit task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    /*
+     * Eagerly started coroutine nobody awaits, e.g. the handler of a connection, it frees itself when it returns
+     */
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object()
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    /*
+     * Single threaded epoll loop resuming coroutines suspended on `readable` / `writable`
+     */
+    class event_loop
+    {
+    public:
+        struct readiness
+        {
+            event_loop &loop;
+            int fd;
+            std::uint32_t events;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                loop.wait(fd, events, handle);
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        event_loop() : m_epoll(::epoll_create1(EPOLL_CLOEXEC)) {}
+
+        ~event_loop()
+        {
+            if (m_epoll >= 0)
+                ::close(m_epoll);
+        }
+
+        event_loop(const event_loop &) = delete;
+        event_loop &operator=(const event_loop &) = delete;
+
+        readiness readable(int fd)
+        {
+            return {*this, fd, EPOLLIN};
+        }
+
+        readiness writable(int fd)
+        {
+            return {*this, fd, EPOLLOUT};
+        }
+
+        /*
+         * Resume the waiting coroutines as their sockets get ready, return once none waits anymore
+         */
+        void run()
+        {
+            epoll_event events[64];
+
+            while (!m_waiters.empty())
+            {
+                auto count = ::epoll_wait(m_epoll, events, 64, -1);
+
+                if (count < 0 && errno != EINTR)
+                    return;
+
+                for (int i = 0; i < count; ++i)
+                {
+                    auto it = m_waiters.find(events[i].data.fd);
+
+                    if (it == m_waiters.end())
+                        continue;
+
+                    auto ready = events[i].events;
+                    auto waiter = it->second;
+                    auto failed = (ready & (EPOLLERR | EPOLLHUP)) != 0;
+
+                    std::coroutine_handle<> resumed[2]{};
+
+                    if (waiter.reader && (failed || (ready & EPOLLIN)))
+                        resumed[0] = std::exchange(it->second.reader, {});
+
+                    if (waiter.writer && (failed || (ready & EPOLLOUT)))
+                        resumed[1] = std::exchange(it->second.writer, {});
+
+                    update(events[i].data.fd, it);
+
+                    for (auto handle : resumed)
+                    {
+                        if (handle)
+                            handle.resume();
+                    }
+                }
+            }
+        }
+
+    private:
+        struct waiter
+        {
+            std::coroutine_handle<> reader;
+            std::coroutine_handle<> writer;
+            bool registered{false};
+        };
+
+        void wait(int fd, std::uint32_t events, std::coroutine_handle<> handle)
+        {
+            auto it = m_waiters.try_emplace(fd).first;
+
+            (events & EPOLLIN ? it->second.reader : it->second.writer) = handle;
+
+            update(fd, it);
+        }
+
+        /* register the interest of the remaining waiters of `fd` */
+        void update(int fd, std::unordered_map<int, waiter>::iterator it)
+        {
+            epoll_event event{};
+
+            event.data.fd = fd;
+            event.events = (it->second.reader ? EPOLLIN : 0u) | (it->second.writer ? EPOLLOUT : 0u);
+
+            if (event.events == 0)
+            {
+                if (it->second.registered)
+                    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+
+                m_waiters.erase(it);
+                return;
+            }
+
+            ::epoll_ctl(m_epoll, it->second.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+
+            it->second.registered = true;
+        }
+
+        int m_epoll;
+        std::unordered_map<int, waiter> m_waiters;
+    };
+
+    /*
+     * Receive the next frame into `receiver`, decode it with `receiver.decode<_Ty>()` once `io_status::done` is returned
+     */
+    inline task<io_status> async_receive(event_loop &loop, int fd, frame_receiver &receiver)
+    {
+        while (true)
+        {
+            auto status = receiver.receive(fd);
+
+            if (status != io_status::would_block)
+                co_return status;
+
+            co_await loop.readable(fd);
+        }
+    }
+
+#if defined(ZPACKER_HAS_FIBERS)
+
+    /*
+     * Receive and decode the next frame with `decoder`, its outcome is `decoder.result()` once `io_status::done` is
+     * returned
+     */
+    template <class _Ty, class _CheckSum>
+    task<io_status> async_receive(event_loop &loop, int fd, frame_decoder<_Ty, _CheckSum> &decoder)
+    {
+        while (true)
+        {
+            auto status = decoder.receive(fd);
+
+            if (status != io_status::would_block)
+                co_return status;
+
+            co_await loop.readable(fd);
+        }
+    }
+
+#endif
+
+    /*
+     * Send the frame queued in `sender`
+     */
+    inline task<io_status> async_send(event_loop &loop, int fd, frame_sender &sender)
+    {
+        while (true)
+        {
+            auto status = sender.send(fd);
+
+            if (status != io_status::would_block)
+                co_return status;
+
+            co_await loop.writable(fd);
+        }
+    }
+
+#endif
+}
@@ -0,0 +1,706 @@
+#pragma once
+
+/*
+ * Flat layout: values read in place, nothing is decoded
+ *
+ * `flat_writer` lays a value out so that every field sits at a fixed, aligned offset. Trivially copyable values are
+ * stored as they are, pairs, tuples and aggregates field after field, containers as a reference (uint32 offset,
+ * uint32 count) to their elements stored out of line. `flat_root` returns a `flat_view` over the buffer, a mmapped
+ * file or a region of shared memory, every access reads the field it needs from there.
+ *
+ * layout: uint32 "ZPFL" | uint16 flat version | uint16 reserved | uint32 root offset | uint32 length | root | elements
+ *
+ * The flat version changes with the flat layout only, independently of the wire `VERSION` of `serialize`.
+ *
+ * Offsets are relative to the start of the buffer. Accessors copy values out and work at any alignment,
+ * `flat_view::data` hands out element pointers only when the buffer is aligned like the elements (malloc and mmap
+ * are). The flat layout is not the wire format of `serialize`: it trades size for random access and, like a raw
+ * struct, is only read back by the same type on a machine of the same byte order.
+ */
+
+#include "zpacker.hpp"
+
+namespace zeus
+{
+    /* inline part of a container in the flat layout, its elements are stored out of line */
+    struct flat_ref
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    namespace detail
+    {
+        constexpr std::uint32_t flat_magic = 0x4c46505a; /* "ZPFL" */
+
+        /* version of the flat layout, bumped when the layout of a value changes */
+        constexpr std::uint16_t flat_version = 1;
+
+        struct flat_header
+        {
+            std::uint32_t magic;
+            std::uint16_t version;
+            std::uint16_t reserved;
+            std::uint32_t root;
+            std::uint32_t length;
+        };
+
+        constexpr std::size_t flat_header_size = sizeof(flat_header);
+
+        /* elements of a container, resolved from its `flat_ref` */
+        struct flat_range
+        {
+            std::size_t offset;
+            std::size_t count;
+        };
+
+        enum class flat_kind
+        {
+            /* stored as they are */
+            raw,
+
+            /* pairs, tuples and aggregates, field after field */
+            members,
+
+            /* std::array of values that are not trivially copyable, element after element */
+            array,
+
+            /* sequence and associative containers, a `flat_ref` to the elements */
+            container,
+
+            none
+        };
+
+        template <class _Ty>
+        constexpr flat_kind flat_kind_of()
+        {
+            constexpr auto dt = get_data_type<_Ty>();
+
+            if constexpr (dt == d_pair || dt == d_tuple)
+                return flat_kind::members;
+            else if constexpr (is_reflectable_v<_Ty> && !std::is_trivially_copyable_v<_Ty>)
+                return flat_kind::members;
+            else if constexpr (dt == d_seq_container || dt == d_aso_container)
+                return flat_kind::container;
+            else if constexpr (std::is_trivially_copyable_v<_Ty>)
+                return flat_kind::raw;
+            else if constexpr (is_std_array_v<_Ty>)
+                return flat_kind::array;
+            else
+                return flat_kind::none;
+        }
+
+        template <class _Ty, bool = has_mapped_type_v<_Ty>>
+        struct flat_element
+        {
+            using type = typename _Ty::value_type;
+        };
+
+        /* elements of maps are stored as pairs of key and value */
+        template <class _Ty>
+        struct flat_element<_Ty, true>
+        {
+            using type = std::pair<typename _Ty::key_type, typename _Ty::mapped_type>;
+        };
+
+        template <class _Ty>
+        using flat_element_t = typename flat_element<_Ty>::type;
+
+        /* containers storing trivially copyable elements contiguously, copied at once */
+        template <class _Ty>
+        constexpr bool is_flat_contiguous_v = has_data_v<_Ty> &&
+                                              flat_kind_of<typename _Ty::value_type>() == flat_kind::raw;
+
+        constexpr std::size_t flat_align_up(std::size_t value, std::size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        template <class _Ty>
+        constexpr std::size_t flat_align();
+
+        template <class _Ty>
+        constexpr std::size_t flat_size();
+
+        template <class _Ty>
+        constexpr std::size_t flat_stride()
+        {
+            return flat_align_up(flat_size<_Ty>(), flat_align<_Ty>());
+        }
+
+        /* aggregates, see `detail::is_reflectable_v` */
+        template <class _Ty>
+        struct flat_member_types
+        {
+            using type = field_types_t<_Ty>;
+        };
+
+        template <class _First, class _Second>
+        struct flat_member_types<std::pair<_First, _Second>>
+        {
+            using type = std::tuple<std::remove_cv_t<_First>, std::remove_cv_t<_Second>>;
+        };
+
+        template <class... _Types>
+        struct flat_member_types<std::tuple<_Types...>>
+        {
+            using type = std::tuple<std::remove_cv_t<_Types>...>;
+        };
+
+        template <class _Tuple>
+        struct flat_members;
+
+        /* offsets of the fields of a pair, a tuple or an aggregate, each aligned like its type, the last one is the total size */
+        template <class... _Members>
+        struct flat_members<std::tuple<_Members...>>
+        {
+            static constexpr std::size_t align = (std::max)({std::size_t{1}, flat_align<_Members>()...});
+
+            static constexpr std::array<std::size_t, sizeof...(_Members) + 1> offsets = []()
+            {
+                constexpr std::size_t aligns[] = {flat_align<_Members>()..., align};
+                constexpr std::size_t sizes[] = {flat_size<_Members>()..., 0};
+
+                std::array<std::size_t, sizeof...(_Members) + 1> result{};
+                std::size_t pos = 0;
+
+                for (std::size_t i = 0; i <= sizeof...(_Members); ++i)
+                {
+                    pos = flat_align_up(pos, aligns[i]);
+                    result[i] = pos;
+                    pos += sizes[i];
+                }
+
+                return result;
+            }();
+
+            static constexpr std::size_t size = offsets[sizeof...(_Members)];
+
+            template <std::size_t _Index>
+            using type = std::tuple_element_t<_Index, std::tuple<_Members...>>;
+        };
+
+        template <class _Ty>
+        using flat_members_t = flat_members<typename flat_member_types<_Ty>::type>;
+
+        template <class _Ty>
+        constexpr std::size_t flat_align()
+        {
+            constexpr auto kind = flat_kind_of<_Ty>();
+
+            static_assert(kind != flat_kind::none, "the type has no flat layout, use trivially copyable types, pairs, tuples, aggregates and containers of them");
+
+            if constexpr (kind == flat_kind::raw)
+                return alignof(_Ty);
+            else if constexpr (kind == flat_kind::members)
+                return flat_members_t<_Ty>::align;
+            else if constexpr (kind == flat_kind::array)
+                return flat_align<typename _Ty::value_type>();
+            else
+                return alignof(flat_ref);
+        }
+
+        template <class _Ty>
+        constexpr std::size_t flat_size()
+        {
+            constexpr auto kind = flat_kind_of<_Ty>();
+
+            if constexpr (kind == flat_kind::raw)
+                return sizeof(_Ty);
+            else if constexpr (kind == flat_kind::members)
+                return flat_members_t<_Ty>::size;
+            else if constexpr (kind == flat_kind::array)
+                return std::tuple_size_v<_Ty> * flat_stride<typename _Ty::value_type>();
+            else
+                return sizeof(flat_ref);
+        }
+    }
+
+    /*
+     * Lay out values in the flat layout, see `flat_root` to read them
+     */
+    class flat_writer
+    {
+    public:
+        explicit flat_writer(std::vector<std::uint8_t> &data) : m_data(data) {}
+
+        /*
+         * Replace the content of the buffer by `value`, offsets and counts are 32 bits wide: larger layouts fail with
+         * `error_code::overflow`
+         */
+        template <class _Ty>
+        error_code write_root(const _Ty &value)
+        {
+            m_data.assign(detail::flat_header_size, 0);
+            m_overflow = false;
+
+            auto root = allocate(detail::flat_size<_Ty>(), detail::flat_align<_Ty>());
+
+            store(root, value);
+
+            if (m_overflow || m_data.size() > (std::numeric_limits<std::uint32_t>::max)())
+                return error_code::overflow;
+
+            detail::flat_header header{detail::flat_magic, detail::flat_version, 0, static_cast<std::uint32_t>(root), static_cast<std::uint32_t>(m_data.size())};
+
+            memcpy(m_data.data(), &header, sizeof(header));
+
+            return error_code::none;
+        }
+
+    private:
+        /* zero filled, padding included, so that equal values have equal layouts */
+        std::size_t allocate(std::size_t size, std::size_t alignment)
+        {
+            auto pos = detail::flat_align_up(m_data.size(), alignment);
+
+            m_data.resize(pos + size);
+
+            return pos;
+        }
+
+        template <class _Ty>
+        void store(std::size_t pos, const _Ty &value)
+        {
+            constexpr auto kind = detail::flat_kind_of<_Ty>();
+
+            if constexpr (kind == detail::flat_kind::raw)
+            {
+                memcpy(m_data.data() + pos, std::addressof(value), sizeof(_Ty));
+            }
+            else if constexpr (kind == detail::flat_kind::members)
+            {
+                using members = typename detail::flat_member_types<_Ty>::type;
+
+                store_members(pos, value, std::make_index_sequence<std::tuple_size_v<members>>{});
+            }
+            else if constexpr (kind == detail::flat_kind::array)
+            {
+                constexpr auto stride = detail::flat_stride<typename _Ty::value_type>();
+
+                for (std::size_t i = 0; i < value.size(); ++i)
+                    store(pos + i * stride, value[i]);
+            }
+            else
+            {
+                using element_type = detail::flat_element_t<_Ty>;
+
+                constexpr auto stride = detail::flat_stride<element_type>();
+
+                auto count = value.size();
+                auto offset = allocate(count * stride, detail::flat_align<element_type>());
+
+                if constexpr (detail::is_flat_contiguous_v<_Ty>)
+                {
+                    if (count != 0)
+                        memcpy(m_data.data() + offset, value.data(), count * stride);
+                }
+                else
+                {
+                    auto element_pos = offset;
+
+                    for (auto &&element : value)
+                    {
+                        store(element_pos, element);
+                        element_pos += stride;
+                    }
+                }
+
+                if (offset > (std::numeric_limits<std::uint32_t>::max)() || count > (std::numeric_limits<std::uint32_t>::max)())
+                    m_overflow = true;
+
+                flat_ref ref{static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(count)};
+
+                memcpy(m_data.data() + pos, &ref, sizeof(ref));
+            }
+        }
+
+        template <class _Ty, std::size_t... _Index>
+        void store_members([[maybe_unused]] std::size_t pos, [[maybe_unused]] const _Ty &value, std::index_sequence<_Index...>)
+        {
+            using members = detail::flat_members_t<_Ty>;
+
+            if constexpr (is_specialize_of_v<_Ty, std::pair> || is_specialize_of_v<_Ty, std::tuple>)
+            {
+                (store(pos + members::offsets[_Index], std::get<_Index>(value)), ...);
+            }
+            else
+            {
+                auto fields = detail::tie_fields(value);
+
+                (store(pos + members::offsets[_Index], std::get<_Index>(fields)), ...);
+            }
+        }
+
+        std::vector<std::uint8_t> &m_data;
+        bool m_overflow{false};
+    };
+
+    /*
+     * Read-only accessor of a value of type `_Ty` in a flat layout, it points into the buffer which must outlive it
+     *
+     * - trivially copyable values: `get`
+     * - pairs, tuples and aggregates: `get<I>`, `first`, `second`
+     * - containers and std::array: `size`, `operator[]`, `at`, iteration, `data` for trivially copyable elements
+     * - strings: `view`
+     * - maps and sets: `find`, a binary search when the container is ordered by std::less
+     *
+     * A reference pointing beyond the buffer reads as an empty container, nothing is read out of bounds. An empty view,
+     * as returned by `at` and `find` when there is no such element, reads as zero values and empty containers.
+     */
+    template <class _Ty>
+    class flat_view
+    {
+        static constexpr auto kind = detail::flat_kind_of<_Ty>();
+
+        template <class _Cty, class = void>
+        struct element_of
+        {
+            using type = void;
+        };
+
+        template <class _Cty>
+        struct element_of<_Cty, std::enable_if_t<detail::flat_kind_of<_Cty>() == detail::flat_kind::container>>
+        {
+            using type = detail::flat_element_t<_Cty>;
+        };
+
+        template <class _Cty>
+        struct element_of<_Cty, std::enable_if_t<detail::flat_kind_of<_Cty>() == detail::flat_kind::array>>
+        {
+            using type = typename _Cty::value_type;
+        };
+
+    public:
+        using element_type = typename element_of<_Ty>::type;
+
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = flat_view<element_type>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            iterator() = default;
+
+            iterator(const std::uint8_t *base, std::size_t length, std::size_t pos) : m_base(base), m_length(length), m_pos(pos) {}
+
+            value_type operator*() const
+            {
+                return {m_base, m_length, m_pos};
+            }
+
+            iterator &operator++()
+            {
+                m_pos += detail::flat_stride<element_type>();
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto it = *this;
+                ++*this;
+                return it;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return m_pos == other.m_pos;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return m_pos != other.m_pos;
+            }
+
+        private:
+            const std::uint8_t *m_base{nullptr};
+            std::size_t m_length{0};
+            std::size_t m_pos{0};
+        };
+
+        flat_view() = default;
+
+        flat_view(const std::uint8_t *base, std::size_t length, std::size_t pos) : m_base(base), m_length(length), m_pos(pos) {}
+
+        explicit operator bool() const
+        {
+            return m_base != nullptr;
+        }
+
+        /*
+         * Copy of a trivially copyable value, a value-initialized one if it lies beyond the buffer
+         */
+        _Ty get() const
+        {
+            static_assert(kind == detail::flat_kind::raw, "only trivially copyable values are copied out, access the fields of the others");
+
+            _Ty value{};
+
+            if (m_base != nullptr && m_pos <= m_length && sizeof(_Ty) <= m_length - m_pos)
+                memcpy(std::addressof(value), m_base + m_pos, sizeof(_Ty));
+
+            return value;
+        }
+
+        /*
+         * Field of a pair, a tuple or an aggregate
+         */
+        template <std::size_t _Index>
+        auto get() const
+        {
+            static_assert(kind == detail::flat_kind::members, "only pairs, tuples and aggregates have fields");
+
+            using members = detail::flat_members_t<_Ty>;
+
+            return flat_view<typename members::template type<_Index>>{m_base, m_length, m_pos + members::offsets[_Index]};
+        }
+
+        auto first() const
+        {
+            return get<0>();
+        }
+
+        auto second() const
+        {
+            return get<1>();
+        }
+
+        std::size_t size() const
+        {
+            return elements().count;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /*
+         * Element `index` of a container, not checked against the size, see `at`
+         * Reads through the view stay within the buffer wherever it points to
+         */
+        flat_view<element_type> operator[](std::size_t index) const
+        {
+            return {m_base, m_length, elements().offset + index * detail::flat_stride<element_type>()};
+        }
+
+        /*
+         * Element `index` of a container, an empty view past the end
+         */
+        flat_view<element_type> at(std::size_t index) const
+        {
+            auto ref = elements();
+
+            if (index >= ref.count)
+                return {};
+
+            return {m_base, m_length, ref.offset + index * detail::flat_stride<element_type>()};
+        }
+
+        iterator begin() const
+        {
+            return {m_base, m_length, elements().offset};
+        }
+
+        iterator end() const
+        {
+            auto ref = elements();
+
+            return {m_base, m_length, ref.offset + ref.count * detail::flat_stride<element_type>()};
+        }
+
+        /*
+         * Trivially copyable elements of a container in place, nullptr if the buffer is not aligned for them
+         */
+        const element_type *data() const
+        {
+            static_assert(detail::flat_kind_of<element_type>() == detail::flat_kind::raw, "only trivially copyable elements are handed out in place");
+
+            if (m_base == nullptr)
+                return nullptr;
+
+            auto elements_data = m_base + elements().offset;
+
+            if (reinterpret_cast<std::uintptr_t>(elements_data) % alignof(element_type) != 0)
+                return nullptr;
+
+            return reinterpret_cast<const element_type *>(elements_data);
+        }
+
+        /*
+         * Characters of a string in place
+         */
+        auto view() const
+        {
+            static_assert(is_specialize_of_v<_Ty, std::basic_string>, "only strings are viewed as such");
+
+            auto ref = elements();
+
+            if (m_base == nullptr)
+                return std::basic_string_view<element_type>{};
+
+            return std::basic_string_view<element_type>{reinterpret_cast<const element_type *>(m_base + ref.offset), ref.count};
+        }
+
+        /*
+         * Element of a map or a set with the key `key`, an empty view if there is none
+         *
+         * Containers ordered by std::less are searched in O(log n), the others are scanned.
+         */
+        template <class _Kty>
+        flat_view<element_type> find(const _Kty &key) const
+        {
+            static_assert(is_associated_container_v<_Ty>, "only maps and sets are searched by key");
+
+            auto ref = elements();
+
+            constexpr auto stride = detail::flat_stride<element_type>();
+
+            auto key_at = [this, &ref](std::size_t index)
+            {
+                flat_view<element_type> element{m_base, m_length, ref.offset + index * stride};
+
+                if constexpr (has_mapped_type_v<_Ty>)
+                    return load(element.first());
+                else
+                    return load(element);
+            };
+
+            if constexpr (is_ordered_by_less())
+            {
+                std::size_t low = 0, high = ref.count;
+
+                while (low < high)
+                {
+                    auto middle = low + (high - low) / 2;
+
+                    if (key_at(middle) < key)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+
+                if (low < ref.count && key_at(low) == key)
+                    return {m_base, m_length, ref.offset + low * stride};
+            }
+            else
+            {
+                for (std::size_t i = 0; i < ref.count; ++i)
+                {
+                    if (key_at(i) == key)
+                        return {m_base, m_length, ref.offset + i * stride};
+                }
+            }
+
+            return {};
+        }
+
+        /*
+         * Offset of the value from the start of the buffer
+         */
+        std::size_t offset() const
+        {
+            return m_pos;
+        }
+
+    private:
+        /* the elements of a container, none if the reference points beyond the buffer or the view is empty */
+        detail::flat_range elements() const
+        {
+            static_assert(kind == detail::flat_kind::container || kind == detail::flat_kind::array, "only containers have elements");
+
+            if (m_base == nullptr)
+                return {0, 0};
+
+            constexpr auto stride = detail::flat_stride<element_type>();
+
+            if constexpr (kind == detail::flat_kind::array)
+            {
+                if (m_pos > m_length || std::tuple_size_v<_Ty> * stride > m_length - m_pos)
+                    return {0, 0};
+
+                return {m_pos, std::tuple_size_v<_Ty>};
+            }
+            else
+            {
+                if (m_pos > m_length || sizeof(flat_ref) > m_length - m_pos)
+                    return {0, 0};
+
+                flat_ref ref{};
+
+                memcpy(&ref, m_base + m_pos, sizeof(ref));
+
+                if (ref.offset > m_length || (stride != 0 && ref.count > (m_length - ref.offset) / stride))
+                    return {0, 0};
+
+                return {ref.offset, ref.count};
+            }
+        }
+
+        static constexpr bool is_ordered_by_less()
+        {
+            if constexpr (has_key_compare_v<_Ty>)
+                return std::is_same_v<typename _Ty::key_compare, std::less<typename _Ty::key_type>> ||
+                       std::is_same_v<typename _Ty::key_compare, std::less<>>;
+            else
+                return false;
+        }
+
+        template <class _Vty>
+        static auto load(const flat_view<_Vty> &value)
+        {
+            if constexpr (is_specialize_of_v<_Vty, std::basic_string>)
+                return value.view();
+            else
+                return value.get();
+        }
+
+        const std::uint8_t *m_base{nullptr};
+        std::size_t m_length{0};
+        std::size_t m_pos{0};
+    };
+
+    /*
+     * Serialize a object into the flat layout, an empty buffer if it is too large for 32-bit offsets
+     */
+    template <class _Ty>
+    std::vector<std::uint8_t> serialize_flat(const _Ty &value)
+    {
+        std::vector<std::uint8_t> result{};
+
+        flat_writer writer{result};
+
+        if (writer.write_root(value) != error_code::none)
+            result.clear();
+
+        return result;
+    }
+
+    /*
+     * View of the root value of a flat layout, an empty view if the buffer does not hold one of this format version
+     *
+     * The header and the extent of the root are checked, references are checked as they are followed. The type is not
+     * recorded: the view must be opened with the type it was written with.
+     */
+    template <class _Ty>
+    flat_view<_Ty> flat_root(const void *buffer, std::size_t length)
+    {
+        auto data = static_cast<const std::uint8_t *>(buffer);
+
+        detail::flat_header header{};
+
+        if (data == nullptr || length < sizeof(header))
+            return {};
+
+        memcpy(&header, data, sizeof(header));
+
+        if (header.magic != detail::flat_magic || header.version != detail::flat_version || header.length > length ||
+            header.root < sizeof(header) || header.root > header.length || detail::flat_size<_Ty>() > header.length - header.root)
+            return {};
+
+        return {data, header.length, header.root};
+    }
+}
@@ -0,0 +1,738 @@
+#pragma once
+
+/*
+ * Snapshot files (Linux)
+ *
+ * `save_snapshot` serializes straight into a ring of aligned blocks: a full block is handed to io_uring and the next
+ * one is filled while the kernel writes the previous ones. `load_snapshot` keeps several block reads in flight.
+ * Both fall back to pwrite / pread when io_uring or its read and write operations are not available. The files are
+ * those of `serialize`.
+ */
+
+#include "zpacker.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace zeus
+{
+    struct file_options
+    {
+        /* size of the blocks in flight, a multiple of 4096 */
+        std::size_t block_size{1024 * 1024};
+
+        /* blocks in flight at once */
+        std::size_t queue_depth{4};
+
+        /* O_DIRECT, bypass the page cache, ignored by file systems that do not support it */
+        bool direct{false};
+
+        /* false forces pread / pwrite */
+        bool uring{true};
+    };
+
+    namespace detail
+    {
+        constexpr std::size_t io_alignment = 4096;
+
+        constexpr std::size_t align_up(std::size_t value, std::size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        struct aligned_free
+        {
+            void operator()(std::uint8_t *data) const
+            {
+                std::free(data);
+            }
+        };
+
+        using aligned_buffer = std::unique_ptr<std::uint8_t[], aligned_free>;
+
+        /* empty when the memory is not available, errno is ENOMEM */
+        inline aligned_buffer allocate_aligned(std::size_t size)
+        {
+            auto data = std::aligned_alloc(io_alignment, align_up((std::max)(size, std::size_t{1}), io_alignment));
+
+            if (data == nullptr)
+                errno = ENOMEM;
+
+            return aligned_buffer{static_cast<std::uint8_t *>(data)};
+        }
+
+        /*
+         * The part of io_uring needed for reads and writes at an offset, set up with the raw system calls
+         */
+        class io_ring
+        {
+        public:
+            io_ring() = default;
+
+            io_ring(const io_ring &) = delete;
+            io_ring &operator=(const io_ring &) = delete;
+
+            ~io_ring()
+            {
+                if (m_sqes != MAP_FAILED)
+                    ::munmap(m_sqes, m_sqes_size);
+
+                if (m_cq != MAP_FAILED && m_cq != m_sq)
+                    ::munmap(m_cq, m_cq_size);
+
+                if (m_sq != MAP_FAILED)
+                    ::munmap(m_sq, m_sq_size);
+
+                if (m_fd >= 0)
+                    ::close(m_fd);
+            }
+
+            /*
+             * Return false if the kernel does not provide io_uring or its read and write operations (before 5.6)
+             */
+            bool open(unsigned entries)
+            {
+                io_uring_params params{};
+
+                m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+                if (m_fd < 0)
+                    return false;
+
+                m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+                if (params.features & IORING_FEAT_SINGLE_MMAP)
+                    m_sq_size = m_cq_size = (std::max)(m_sq_size, m_cq_size);
+
+                m_sq = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+
+                if (m_sq == MAP_FAILED)
+                    return false;
+
+                m_cq = params.features & IORING_FEAT_SINGLE_MMAP
+                           ? m_sq
+                           : ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+
+                if (m_cq == MAP_FAILED)
+                    return false;
+
+                m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                m_sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+
+                if (m_sqes == MAP_FAILED)
+                    return false;
+
+                auto sq = static_cast<std::uint8_t *>(m_sq);
+                auto cq = static_cast<std::uint8_t *>(m_cq);
+
+                m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                m_sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+                m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                m_cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+                return can_read_write();
+            }
+
+            /*
+             * Queue a read or a write and submit it, the caller keeps at most `entries` of them in flight
+             */
+            bool submit(std::uint8_t opcode, int fd, void *data, std::uint32_t length, std::uint64_t offset, std::uint64_t user_data)
+            {
+                auto tail = *m_sq_tail;
+                auto index = tail & m_sq_mask;
+                auto &sqe = static_cast<io_uring_sqe *>(m_sqes)[index];
+
+                memset(&sqe, 0, sizeof(sqe));
+
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<std::uint64_t>(data);
+                sqe.len = length;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+
+                m_sq_array[index] = index;
+
+                __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+                while (::syscall(__NR_io_uring_enter, m_fd, 1, 0, 0, nullptr, 0) < 0)
+                {
+                    if (errno != EINTR)
+                        return false;
+                }
+
+                return true;
+            }
+
+            /*
+             * Wait for the next completion, false only when the ring itself is broken
+             */
+            bool wait(io_uring_cqe &cqe)
+            {
+                while (true)
+                {
+                    auto head = *m_cq_head;
+
+                    if (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+                    {
+                        cqe = m_cqes[head & m_cq_mask];
+
+                        __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+
+                        return true;
+                    }
+
+                    if (::syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+                        return false;
+                }
+            }
+
+        private:
+            /* the probe came with the read and write operations, older kernels fail every one of them with EINVAL */
+            bool can_read_write()
+            {
+                alignas(io_uring_probe) std::uint8_t storage[sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)]{};
+                auto probe = reinterpret_cast<io_uring_probe *>(storage);
+
+                if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+                    return false;
+
+                auto supported = [&](std::uint8_t opcode)
+                {
+                    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+                };
+
+                return supported(IORING_OP_READ) && supported(IORING_OP_WRITE);
+            }
+
+            int m_fd{-1};
+
+            void *m_sq{MAP_FAILED};
+            void *m_cq{MAP_FAILED};
+            void *m_sqes{MAP_FAILED};
+
+            std::size_t m_sq_size{0};
+            std::size_t m_cq_size{0};
+            std::size_t m_sqes_size{0};
+
+            unsigned *m_sq_tail{nullptr};
+            unsigned m_sq_mask{0};
+            unsigned *m_sq_array{nullptr};
+
+            unsigned *m_cq_head{nullptr};
+            unsigned *m_cq_tail{nullptr};
+            unsigned m_cq_mask{0};
+            io_uring_cqe *m_cqes{nullptr};
+        };
+
+        inline bool pwrite_all(int fd, const std::uint8_t *data, std::size_t length, std::uint64_t offset)
+        {
+            while (length != 0)
+            {
+                auto n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+
+                if (n < 0 && errno == EINTR)
+                    continue;
+
+                if (n <= 0)
+                    return false;
+
+                data += n;
+                length -= static_cast<std::size_t>(n);
+                offset += static_cast<std::uint64_t>(n);
+            }
+
+            return true;
+        }
+
+        /* stops at the end of the file, return the bytes read or -1 */
+        inline std::int64_t pread_all(int fd, std::uint8_t *data, std::size_t length, std::uint64_t offset)
+        {
+            std::size_t total = 0;
+
+            while (total < length)
+            {
+                auto n = ::pread(fd, data + total, length - total, static_cast<off_t>(offset + total));
+
+                if (n < 0 && errno == EINTR)
+                    continue;
+
+                if (n < 0)
+                    return -1;
+
+                if (n == 0)
+                    break;
+
+                total += static_cast<std::size_t>(n);
+            }
+
+            return static_cast<std::int64_t>(total);
+        }
+
+        /* fill `data` with the first `size` bytes of the file, `options.queue_depth` block reads in flight */
+        inline bool read_blocks(int fd, std::uint8_t *data, std::size_t size, const file_options &options)
+        {
+            const auto direct = (::fcntl(fd, F_GETFL) & O_DIRECT) != 0;
+            const auto block_size = align_up((std::max)(options.block_size, io_alignment), io_alignment);
+            const auto depth = (std::max)(options.queue_depth, std::size_t{1});
+
+            /* O_DIRECT reads whole sectors, `data` is allocated with room for the padding */
+            auto length_at = [&](std::size_t offset)
+            {
+                auto length = (std::min)(block_size, size - offset);
+
+                return direct ? align_up(length, io_alignment) : length;
+            };
+
+            io_ring ring{};
+
+            if (!options.uring || !ring.open(static_cast<unsigned>(depth)))
+                return pread_all(fd, data, direct ? align_up(size, io_alignment) : size, 0) >= static_cast<std::int64_t>(size);
+
+            std::size_t next = 0;
+            std::size_t in_flight = 0;
+            int failure = 0;
+
+            /* after a failure nothing more is queued, but every read in flight is waited for before `data` is given back */
+            while (in_flight != 0 || (next < size && failure == 0))
+            {
+                while (failure == 0 && next < size && in_flight < depth)
+                {
+                    if (!ring.submit(IORING_OP_READ, fd, data + next, static_cast<std::uint32_t>(length_at(next)), next, next))
+                    {
+                        failure = errno;
+                        break;
+                    }
+
+                    next += block_size;
+                    ++in_flight;
+                }
+
+                if (in_flight == 0)
+                    break;
+
+                io_uring_cqe cqe{};
+
+                if (!ring.wait(cqe))
+                    return false;
+
+                --in_flight;
+
+                if (failure != 0)
+                    continue;
+
+                if (cqe.res < 0)
+                {
+                    failure = -cqe.res;
+                    continue;
+                }
+
+                /* finish a short read synchronously */
+                auto offset = static_cast<std::size_t>(cqe.user_data);
+                auto done = static_cast<std::size_t>(cqe.res);
+                auto wanted = (std::min)(block_size, size - offset);
+
+                if (done < wanted && pread_all(fd, data + offset + done, length_at(offset) - done, offset + done) < static_cast<std::int64_t>(wanted - done))
+                    failure = errno != 0 ? errno : EIO;
+            }
+
+            errno = failure;
+
+            return failure == 0;
+        }
+
+        inline int open_file(const char *path, int flags, bool direct)
+        {
+            if (direct)
+            {
+                auto fd = ::open(path, flags | O_DIRECT | O_CLOEXEC, 0644);
+
+                /* tmpfs and a few others refuse O_DIRECT */
+                if (fd >= 0 || errno != EINVAL)
+                    return fd;
+            }
+
+            return ::open(path, flags | O_CLOEXEC, 0644);
+        }
+    }
+
+    namespace detail
+    {
+        /* checksum fed piece by piece, only the checksums that allow it */
+        template <class _CheckSum>
+        class streaming_checksum;
+
+        template <>
+        class streaming_checksum<empty_checksum>
+        {
+        public:
+            void update(const std::uint8_t *, std::size_t) {}
+
+            std::uint32_t value() const
+            {
+                return 0;
+            }
+        };
+
+        template <>
+        class streaming_checksum<crc32_checksum>
+        {
+        public:
+            void update(const std::uint8_t *data, std::size_t length)
+            {
+                for (std::size_t i = 0; i < length; ++i)
+                    m_crc = (m_crc >> 8) ^ CRC32_TABLE[(m_crc ^ data[i]) & 0xFF];
+            }
+
+            std::uint32_t value() const
+            {
+                return ~m_crc;
+            }
+
+        private:
+            std::uint32_t m_crc{0xFFFFFFFF};
+        };
+    }
+
+    /*
+     * Writer filling aligned blocks of a file in order behind a packer header, see `save_snapshot`
+     *
+     * The first block is written last, once `finish` knows the length and the checksum of the payload.
+     */
+    template <class _CheckSum = empty_checksum>
+    class snapshot_writer : public error_state, public format_state, public string_table_state
+    {
+    public:
+        snapshot_writer(int fd, const file_options &options = file_options{})
+            : m_fd(fd),
+              m_block_size(detail::align_up((std::max)(options.block_size, detail::io_alignment), detail::io_alignment)),
+              m_direct((::fcntl(fd, F_GETFL) & O_DIRECT) != 0)
+        {
+            auto depth = (std::max)(options.queue_depth, std::size_t{1});
+
+            /* the first block, the one being filled and the ones in flight */
+            m_blocks.resize(depth + 2);
+
+            for (auto &block : m_blocks)
+            {
+                block.data = detail::allocate_aligned(m_block_size);
+
+                if (!block.data)
+                {
+                    set_error(error_code::io_error);
+                    return;
+                }
+            }
+
+            if (options.uring && m_ring.open(static_cast<unsigned>(depth + 2)))
+                m_uring = true;
+
+            for (std::size_t i = 1; i < m_blocks.size(); ++i)
+                m_free.push_back(i);
+
+            /* patched by `finish` */
+            write(packer_header{});
+        }
+
+        snapshot_writer(const snapshot_writer &) = delete;
+        snapshot_writer &operator=(const snapshot_writer &) = delete;
+
+        /* the kernel may still be reading the blocks, when `finish` was not reached or stopped on an error */
+        ~snapshot_writer()
+        {
+            drain();
+        }
+
+        template <class _Vty>
+        void write(const _Vty &val)
+        {
+            if constexpr (std::is_trivially_copyable_v<_Vty>)
+                write(reinterpret_cast<const std::uint8_t *>(std::addressof(val)), sizeof(_Vty));
+            else
+                serialize_object(*this, val);
+        }
+
+        void write(const std::uint8_t *data, std::size_t length)
+        {
+            while (length != 0 && good())
+            {
+                auto &block = m_blocks[m_current];
+                auto n = (std::min)(length, m_block_size - block.size);
+
+                memcpy(block.data.get() + block.size, data, n);
+
+                block.size += n;
+                data += n;
+                length -= n;
+                m_count += n;
+
+                if (block.size == m_block_size)
+                    seal();
+            }
+        }
+
+        template <class _Vty>
+        snapshot_writer &operator<<(const _Vty &val)
+        {
+            this->write(val);
+
+            return *this;
+        }
+
+        template <class _Ty>
+        constexpr bool can_write() const
+        {
+            return true;
+        }
+
+        void set_error(error_code code)
+        {
+            record_error(code, m_count);
+        }
+
+        /*
+         * Get the total bytes written, packer header included
+         */
+        std::size_t count() const
+        {
+            return m_count;
+        }
+
+        /*
+         * Write the packer header, the partial last block and the first block, wait for every write
+         */
+        bool finish()
+        {
+            if (!good())
+            {
+                drain();
+                return false;
+            }
+
+            update_checksum(m_blocks[m_current]);
+
+            packer_header ph{};
+
+            ph.set_version(VERSION);
+
+            ph.crc.crc32 = m_checksum.value();
+
+            ph.length = static_cast<std::uint32_t>(m_count - sizeof(packer_header));
+
+            memcpy(m_blocks[0].data.get(), &ph, sizeof(ph));
+
+            if (m_current != 0 && m_blocks[m_current].size != 0)
+                submit(m_current);
+
+            submit(0);
+
+            drain();
+
+            /* O_DIRECT writes whole sectors, cut the padding of the last one */
+            if (m_direct && good() && ::ftruncate(m_fd, static_cast<off_t>(m_count)) != 0)
+                set_error(error_code::io_error);
+
+            return good();
+        }
+
+    private:
+        struct block
+        {
+            detail::aligned_buffer data;
+            std::size_t size{0};
+            std::uint64_t offset{0};
+        };
+
+        /* the payload is never in memory at once, its checksum is updated block by block */
+        void update_checksum(const block &b)
+        {
+            auto skip = b.offset == 0 ? sizeof(packer_header) : 0;
+
+            if (b.size > skip)
+                m_checksum.update(b.data.get() + skip, b.size - skip);
+        }
+
+        /* hand over the full current block and continue with a free one */
+        void seal()
+        {
+            update_checksum(m_blocks[m_current]);
+
+            if (m_current != 0)
+                submit(m_current);
+
+            while (m_free.empty() && good())
+                reap();
+
+            if (!good())
+                return;
+
+            m_current = m_free.back();
+            m_free.pop_back();
+
+            m_blocks[m_current].size = 0;
+            m_blocks[m_current].offset = m_count;
+        }
+
+        void submit(std::size_t index)
+        {
+            auto &block = m_blocks[index];
+            auto length = m_direct ? detail::align_up(block.size, detail::io_alignment) : block.size;
+
+            memset(block.data.get() + block.size, 0, length - block.size);
+
+            if (m_uring)
+            {
+                if (!m_ring.submit(IORING_OP_WRITE, m_fd, block.data.get(), static_cast<std::uint32_t>(length), block.offset, index))
+                    return set_error(error_code::io_error);
+
+                ++m_in_flight;
+            }
+            else
+            {
+                if (!detail::pwrite_all(m_fd, block.data.get(), length, block.offset))
+                    return set_error(error_code::io_error);
+
+                if (index != 0)
+                    m_free.push_back(index);
+            }
+        }
+
+        /* wait for every write in flight, errors included */
+        void drain()
+        {
+            while (m_in_flight != 0)
+                reap();
+        }
+
+        void reap()
+        {
+            io_uring_cqe cqe{};
+
+            /* a broken ring completes nothing more */
+            if (!m_ring.wait(cqe))
+            {
+                m_in_flight = 0;
+                return set_error(error_code::io_error);
+            }
+
+            --m_in_flight;
+
+            if (!good())
+                return;
+
+            auto index = static_cast<std::size_t>(cqe.user_data);
+            auto &block = m_blocks[index];
+            auto length = m_direct ? detail::align_up(block.size, detail::io_alignment) : block.size;
+
+            if (cqe.res < 0)
+            {
+                errno = -cqe.res;
+                return set_error(error_code::io_error);
+            }
+
+            /* finish a short write synchronously */
+            auto written = static_cast<std::size_t>(cqe.res);
+
+            if (written < length && !detail::pwrite_all(m_fd, block.data.get() + written, length - written, block.offset + written))
+                return set_error(error_code::io_error);
+
+            if (index != 0)
+                m_free.push_back(index);
+        }
+
+        int m_fd;
+        std::size_t m_block_size;
+        bool m_direct;
+        bool m_uring{false};
+
+        detail::streaming_checksum<_CheckSum> m_checksum{};
+        std::vector<block> m_blocks;
+
+        /* closed before the blocks are freed */
+        detail::io_ring m_ring;
+        std::vector<std::size_t> m_free;
+        std::size_t m_current{0};
+        std::size_t m_in_flight{0};
+        std::size_t m_count{0};
+    };
+
+    /*
+     * Serialize a object into a file, the same bytes as `serialize`
+     * Only `empty_checksum` and `crc32_checksum` can be computed while the blocks are written
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum>
+    error_code save_snapshot(const char *path, const _Ty &value, const file_options &options = file_options{}, _CheckSum = empty_checksum{})
+    {
+        auto fd = detail::open_file(path, O_WRONLY | O_CREAT | O_TRUNC, options.direct);
+
+        if (fd < 0)
+            return error_code::io_error;
+
+        error_code code{};
+
+        {
+            snapshot_writer<_CheckSum> writer{fd, options};
+
+            serialize_object(writer, value);
+
+            writer.finish();
+
+            code = writer.error();
+        }
+
+        if (::close(fd) != 0 && code == error_code::none)
+            code = error_code::io_error;
+
+        return code;
+    }
+
+    /*
+     * Read a file written by `save_snapshot` or `serialize` and decode it, `queue_depth` block reads in flight
+     */
+    template <
+        class _Ty,
+        class _CheckSum = empty_checksum,
+        std::enable_if_t<detail::is_deserializable_v<_Ty, bytes_reader_bounded>, int> = 0>
+    deserialize_result<_Ty> load_snapshot(const char *path, const file_options &options = file_options{}, _CheckSum checksum = empty_checksum{})
+    {
+        auto fd = detail::open_file(path, O_RDONLY, options.direct);
+
+        if (fd < 0)
+            return {error_code::io_error, 0};
+
+        struct stat st
+        {
+        };
+
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return {error_code::io_error, 0};
+        }
+
+        auto size = static_cast<std::size_t>(st.st_size);
+        auto buffer = detail::allocate_aligned(size);
+        auto read = buffer && detail::read_blocks(fd, buffer.get(), size, options);
+
+        ::close(fd);
+
+        if (!read)
+            return {error_code::io_error, 0};
+
+        return try_deserialize<_Ty>(buffer.get(), size, checksum);
+    }
+}